@@ -0,0 +1,150 @@
+#include "background_lexer.h"
+#include "worker_job.h"
+#include <QMap>
+#include <QMutex>
+#include <QThreadPool>
+#include <atomic>
+
+// A speculatively lexed batch waiting for its turn to be stitched
+struct BackgroundLexer::Pending {
+    QStringList lines;
+    Batch batch;
+};
+
+struct BackgroundLexer::Job {
+    CodeLexer::Language language;
+    int entryState;  // State the first batch starts in
+    int state;       // Exit state of the last stitched batch
+    std::atomic<bool> canceled{false};
+    QMutex mutex;
+    int submitted = 0;
+    int nextToStitch = 0;
+    QMap<int, Pending> lexed;  // Finished batches that can't be stitched yet
+    bool stitching = false;    // A pool thread is working through 'lexed'
+    BackgroundLexer* receiver = nullptr;  // Cleared once the lexer stops listening
+};
+
+BackgroundLexer::BackgroundLexer(QObject* parent)
+    : QObject(parent)
+{
+}
+
+BackgroundLexer::~BackgroundLexer() {
+    cancel();
+}
+
+void BackgroundLexer::start(CodeLexer::Language language, int entryState) {
+    cancel();
+    
+    job = std::make_shared<Job>();
+    job->language = language;
+    job->entryState = entryState;
+    job->state = entryState;
+    job->receiver = this;
+}
+
+void BackgroundLexer::submit(const QStringList& lines) {
+    if (!job || lines.isEmpty()) return;
+    
+    std::shared_ptr<Job> started = job;
+    const int index = job->submitted++;
+    QThreadPool::globalInstance()->start([started, index, lines] { lexBatch(started, index, lines); });
+}
+
+void BackgroundLexer::cancel() {
+    if (!job) return;
+    
+    job->canceled = true;
+    {
+        QMutexLocker locker(&job->mutex);
+        job->lexed.clear();
+        job->receiver = nullptr;
+    }
+    job.reset();
+}
+
+void BackgroundLexer::post(const std::shared_ptr<Job>& job, std::function<void(BackgroundLexer*)> fn) {
+    // Results of a job that has since been replaced are dropped on arrival
+    postJobResult(job, &BackgroundLexer::job, std::move(fn));
+}
+
+BackgroundLexer::Batch BackgroundLexer::lex(CodeLexer::Language language, const QStringList& lines, int entryState) {
+    Batch batch;
+    batch.lineCount = lines.size();
+    batch.tokenEnds.reserve(lines.size());
+    batch.states.reserve(lines.size() + 1);
+    batch.states.append(entryState);
+    
+    int state = entryState;
+    for (const QString& line : lines) {
+        state = CodeLexer::lexLine(language, line, state, batch.tokens);
+        batch.tokenEnds.append(batch.tokens.size());
+        batch.states.append(state);
+    }
+    return batch;
+}
+
+void BackgroundLexer::lexBatch(std::shared_ptr<Job> job, int index, QStringList lines) {
+    if (job->canceled) return;
+    
+    // Only the first batch knows its real entry state; the rest guess that
+    // no comment or string is open, which is almost always right
+    const int assumed = index == 0 ? job->entryState : CodeLexer::NormalState;
+    Pending pending{lines, lex(job->language, lines, assumed)};
+    
+    QMutexLocker locker(&job->mutex);
+    if (job->canceled) return;
+    job->lexed.insert(index, pending);
+    if (job->stitching) return;  // Whoever is stitching will pick it up
+    
+    // Stitch and deliver every batch that is next in line
+    job->stitching = true;
+    while (!job->canceled && job->lexed.contains(job->nextToStitch)) {
+        Pending next = job->lexed.take(job->nextToStitch);
+        locker.unlock();
+        
+        stitch(*job, next);
+        const Batch batch = next.batch;
+        post(job, [batch](BackgroundLexer* lexer) {
+            emit lexer->batchReady(batch);
+        });
+        
+        locker.relock();
+        ++job->nextToStitch;
+    }
+    job->stitching = false;
+}
+
+void BackgroundLexer::stitch(Job& job, Pending& pending) {
+    Batch& batch = pending.batch;
+    int state = job.state;
+    
+    if (batch.states[0] != state) {
+        // Re-lex from the real entry state until a line ends in the same
+        // state as the guess did; everything after that is already right
+        Batch fixed;
+        fixed.lineCount = batch.lineCount;
+        fixed.states.append(state);
+        int line = 0;
+        for (; line < batch.lineCount; ++line) {
+            state = CodeLexer::lexLine(job.language, pending.lines[line], state, fixed.tokens);
+            fixed.tokenEnds.append(fixed.tokens.size());
+            fixed.states.append(state);
+            if (state == batch.states[line + 1]) {
+                ++line;
+                break;
+            }
+        }
+        
+        // Splice the untouched tail of the speculative result back on
+        const int shift = fixed.tokens.size() - batch.tokenBegin(line);
+        fixed.tokens.append(batch.tokens.mid(batch.tokenBegin(line)));
+        for (int i = line; i < batch.lineCount; ++i) {
+            fixed.tokenEnds.append(batch.tokenEnds[i] + shift);
+            fixed.states.append(batch.states[i + 1]);
+        }
+        batch = fixed;
+    }
+    
+    job.state = batch.states.last();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include "code_lexer.h"
+
+// Runs CodeLexer over snapshots of document lines on the thread pool.
+// Submitted batches are lexed in parallel, each one assuming it starts
+// outside any multi-line construct; a stitching step then checks them in
+// order against the state the previous batch really ended in and re-lexes
+// lines only until the two states agree again. Results come back on the
+// owner's thread, in order, as compact token spans. Starting a new job or
+// canceling drops everything still queued or in flight for the old one.
+class BackgroundLexer : public QObject {
+    Q_OBJECT
+
+public:
+    struct Batch {
+        int lineCount = 0;
+        QVector<CodeLexer::Token> tokens;  // All lines' tokens back to back
+        QVector<int> tokenEnds;            // Line i's tokens end at tokenEnds[i]
+        QVector<int> states;               // Entry state of each line, then the exit state of the last
+
+        int tokenBegin(int line) const { return line > 0 ? tokenEnds[line - 1] : 0; }
+    };
+
+    explicit BackgroundLexer(QObject* parent = nullptr);
+    ~BackgroundLexer();
+
+    void start(CodeLexer::Language language, int entryState);
+    void submit(const QStringList& lines);
+    void cancel();
+    bool isRunning() const { return job != nullptr; }
+
+signals:
+    void batchReady(const BackgroundLexer::Batch& batch);
+
+private:
+    struct Job;
+    struct Pending;
+    static void lexBatch(std::shared_ptr<Job> job, int index, QStringList lines);
+    static Batch lex(CodeLexer::Language language, const QStringList& lines, int entryState);
+    static void stitch(Job& job, Pending& pending);
+    static void post(const std::shared_ptr<Job>& job, std::function<void(BackgroundLexer*)> fn);
+
+    std::shared_ptr<Job> job;
+};
@@ -0,0 +1,110 @@
+#include "bulk_inserter.h"
+#include <QElapsedTimer>
+#include <QSignalBlocker>
+#include <QTextDocument>
+#include <QTimer>
+
+namespace {
+const qsizetype chunkSize = 256 * 1024;  // Characters per insertText call
+}
+
+BulkInserter::BulkInserter(QTextDocument* document, QObject* parent)
+    : QObject(parent)
+    , document(document)
+    , offset(0)
+    , position(0)
+    , charsRemoved(0)
+    , blockCountBefore(0)
+    , modifiedBefore(false)
+{
+    sliceTimer = new QTimer(this);
+    sliceTimer->setSingleShot(true);
+    sliceTimer->setInterval(0);
+    connect(sliceTimer, &QTimer::timeout, this, &BulkInserter::insertNext);
+}
+
+void BulkInserter::start(const QTextCursor& at, const QString& insertText) {
+    finish();
+    
+    cursor = at;
+    cursor.setKeepPositionOnInsert(false);
+    text = insertText;
+    offset = 0;
+    position = cursor.selectionStart();
+    charsRemoved = cursor.selectionEnd() - cursor.selectionStart();
+    blockCountBefore = document->blockCount();
+    modifiedBefore = document->isModified();
+    
+    {
+        QSignalBlocker blocker(document);
+        cursor.removeSelectedText();
+    }
+    emit started(position);
+    sliceTimer->start();
+}
+
+void BulkInserter::finish() {
+    if (!isRunning()) return;
+    
+    insertChunks(false);
+    complete();
+}
+
+void BulkInserter::stop() {
+    if (!isRunning()) return;
+    
+    text.clear();
+    offset = 0;
+    complete();
+}
+
+void BulkInserter::insertNext() {
+    insertChunks(true);
+    if (offset < text.size()) {
+        emit progress(int(offset * 100 / text.size()));
+        sliceTimer->start();
+    } else {
+        complete();
+    }
+}
+
+void BulkInserter::insertChunks(bool timed) {
+    QElapsedTimer timer;
+    timer.start();
+    QSignalBlocker blocker(document);
+    while (offset < text.size() && !(timed && timer.hasExpired(frameBudgetMs))) {
+        // End chunks after a line break where there is one, and never
+        // between \r\n or the halves of a surrogate pair
+        qsizetype end = qMin(offset + chunkSize, text.size());
+        if (end < text.size()) {
+            const qsizetype lineEnd = text.lastIndexOf(QLatin1Char('\n'), end - 1);
+            if (lineEnd >= offset) {
+                end = lineEnd + 1;
+            } else if (text[end - 1] == QLatin1Char('\r') || text[end - 1].isHighSurrogate()) {
+                ++end;
+            }
+        }
+        cursor.insertText(text.mid(offset, end - offset));
+        offset = end;
+    }
+}
+
+void BulkInserter::complete() {
+    sliceTimer->stop();
+    const int charsAdded = cursor.position() - position;
+    cursor = QTextCursor();
+    text.clear();
+    text.squeeze();
+    offset = 0;
+    
+    // The one announcement of everything that went in
+    emit document->contentsChange(position, charsRemoved, charsAdded);
+    emit document->contentsChanged();
+    if (document->blockCount() != blockCountBefore) {
+        emit document->blockCountChanged(document->blockCount());
+    }
+    if (document->isModified() != modifiedBefore) {
+        emit document->modificationChanged(document->isModified());
+    }
+    emit finished(position, charsAdded);
+}
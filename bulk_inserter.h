@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTextCursor>
+
+class QTextDocument;
+class QTimer;
+
+// Inserts large text into a document in time-sliced chunks, so a huge
+// paste doesn't freeze the window. The document's signals are held back
+// while chunks go in; once the last one is in, a single contentsChange
+// covering the whole insertion is sent instead, so the highlighter,
+// gutter, dirty tracking and undo each do one update rather than one per
+// chunk. Observers that keep their own state must not act on the
+// document between started() and finished().
+class BulkInserter : public QObject {
+    Q_OBJECT
+
+public:
+    explicit BulkInserter(QTextDocument* document, QObject* parent = nullptr);
+
+    // Replaces the cursor's selection with the text
+    void start(const QTextCursor& cursor, const QString& text);
+    void finish();  // Inserts the rest right away
+    void stop();    // Leaves the rest out
+    bool isRunning() const { return !cursor.isNull(); }
+
+signals:
+    void started(int position);
+    void progress(int percent);
+    void finished(int position, int charsAdded);
+
+private slots:
+    void insertNext();
+
+private:
+    void insertChunks(bool timed);
+    void complete();
+
+    QTextDocument* document;
+    QTimer* sliceTimer;
+    QTextCursor cursor;  // Insertion point; null when idle
+    QString text;
+    qsizetype offset;    // Characters of 'text' already inserted
+    int position;
+    int charsRemoved;
+    int blockCountBefore;
+    bool modifiedBefore;
+    const int frameBudgetMs = 8;
+};
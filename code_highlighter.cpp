@@ -1,13 +1,87 @@
 #include "code_highlighter.h"
+#include "latency_monitor.h"
 #include <QApplication>
 #include <QStyleHints>
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTextBlockUserData>
+
+namespace {
+// Token kinds of a block, kept so a theme change can reapply formats
+// without lexing the block again
+struct TokenData : public QTextBlockUserData {
+    QVector<CodeLexer::Token> tokens;
+    int entryState = -1;
+    int exitState = CodeLexer::NormalState;
+    int themeGeneration = -1;  // Theme whose formats the block currently shows
+};
+}
 
 CodeHighlighter::CodeHighlighter(QTextDocument* parent)
     : QSyntaxHighlighter(parent)
     , currentLanguage(None)
+    , recoloring(false)
+    , themeGeneration(0)
+    , visibleFirst(-1)
+    , visibleLast(-1)
+    , visibleDirty(false)
+    , inPass(false)
+    , restartPending(false)
+    , suspended(false)
+    , readyLine(0)
+    , linesInFlight(0)
+    , precomputed(nullptr)
+    , precomputedLine(0)
+    , precomputedPosition(-1)
 {
-    cppCommentStartExp = QRegularExpression(QStringLiteral("/\\*"));
-    cppCommentEndExp = QRegularExpression(QStringLiteral("\\*/"));
+    setupFormats(QApplication::styleHints()->colorScheme() == Qt::ColorScheme::Dark);
+    
+    lexer = new BackgroundLexer(this);
+    connect(lexer, &BackgroundLexer::batchReady, this, &CodeHighlighter::handleBatch);
+    
+    // Edits made while a pass runs may invalidate what the worker has queued
+    if (parent) {
+        connect(parent, &QTextDocument::contentsChange,
+                this, &CodeHighlighter::handleContentsChange);
+    }
+    
+    idleTimer = new QTimer(this);
+    idleTimer->setSingleShot(true);
+    idleTimer->setInterval(0);
+    connect(idleTimer, &QTimer::timeout, this, &CodeHighlighter::continueHighlighting);
+}
+
+void CodeHighlighter::setEditor(QPlainTextEdit* editor) {
+    this->editor = editor;
+    
+    // Scrolling, resizing and zooming pull the newly exposed blocks to the
+    // front of a running pass and bring them up to date with the current
+    // theme. Relayouts such as a zoom repaint the whole viewport; partial
+    // updates (the cursor, an edited line) expose nothing new.
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, &CodeHighlighter::handleViewportChange);
+    connect(editor, &QPlainTextEdit::updateRequest, this, [this](const QRect& rect, int dy) {
+        if (dy == 0 && rect.contains(this->editor->viewport()->rect())) {
+            handleViewportChange();
+        }
+    });
+    editor->viewport()->installEventFilter(this);
+}
+
+bool CodeHighlighter::eventFilter(QObject* obj, QEvent* event) {
+    // The new size is laid out after the event, so look once that is done
+    if (editor && obj == editor->viewport() && event->type() == QEvent::Resize) {
+        QMetaObject::invokeMethod(this, &CodeHighlighter::handleViewportChange, Qt::QueuedConnection);
+    }
+    return QSyntaxHighlighter::eventFilter(obj, event);
+}
+
+void CodeHighlighter::handleViewportChange() {
+    recolorVisible();
+    scheduleVisible();
 }
 
 void CodeHighlighter::setupFormats(bool isDarkMode) {
@@ -22,224 +96,311 @@ void CodeHighlighter::setupFormats(bool isDarkMode) {
     QColor decoratorColor = isDarkMode ? QColor("#569CD6") : QColor("#0000FF");
 
     // Setup formats
-    keywordFormat.setForeground(keywordColor);
-    keywordFormat.setFontWeight(QFont::Bold);
-
-    classFormat.setForeground(classColor);
-
-    singleLineCommentFormat.setForeground(commentColor);
-    multiLineCommentFormat.setForeground(commentColor);
-
-    quotationFormat.setForeground(stringColor);
-    
-    functionFormat.setForeground(functionColor);
-    
-    numberFormat.setForeground(numberColor);
-    
-    preprocessorFormat.setForeground(preprocessorColor);
-    
-    decoratorFormat.setForeground(decoratorColor);
-}
-
-void CodeHighlighter::setupCPPRules() {
-    rules.clear();
-
-    // Keywords
-    const QString keywordPatterns[] = {
-        QStringLiteral("\\bclass\\b"), QStringLiteral("\\bconst\\b"),
-        QStringLiteral("\\benum\\b"), QStringLiteral("\\bexplicit\\b"),
-        QStringLiteral("\\bfriend\\b"), QStringLiteral("\\binline\\b"),
-        QStringLiteral("\\bnamespace\\b"), QStringLiteral("\\boperator\\b"),
-        QStringLiteral("\\bprivate\\b"), QStringLiteral("\\bprotected\\b"),
-        QStringLiteral("\\bpublic\\b"), QStringLiteral("\\bsignals\\b"),
-        QStringLiteral("\\bslots\\b"), QStringLiteral("\\bstatic\\b"),
-        QStringLiteral("\\bstruct\\b"), QStringLiteral("\\btemplate\\b"),
-        QStringLiteral("\\btypedef\\b"), QStringLiteral("\\btypename\\b"),
-        QStringLiteral("\\bunion\\b"), QStringLiteral("\\bvirtual\\b"),
-        QStringLiteral("\\bvolatile\\b"), QStringLiteral("\\bbreak\\b"),
-        QStringLiteral("\\bcase\\b"), QStringLiteral("\\bcatch\\b"),
-        QStringLiteral("\\bcontinue\\b"), QStringLiteral("\\bdefault\\b"),
-        QStringLiteral("\\bdelete\\b"), QStringLiteral("\\bdo\\b"),
-        QStringLiteral("\\belse\\b"), QStringLiteral("\\bfor\\b"),
-        QStringLiteral("\\bgoto\\b"), QStringLiteral("\\bif\\b"),
-        QStringLiteral("\\bnew\\b"), QStringLiteral("\\breturn\\b"),
-        QStringLiteral("\\bswitch\\b"), QStringLiteral("\\btry\\b"),
-        QStringLiteral("\\bwhile\\b"), QStringLiteral("\\bauto\\b"),
-        QStringLiteral("\\bbool\\b"), QStringLiteral("\\bchar\\b"),
-        QStringLiteral("\\bdouble\\b"), QStringLiteral("\\bfloat\\b"),
-        QStringLiteral("\\bint\\b"), QStringLiteral("\\blong\\b"),
-        QStringLiteral("\\bshort\\b"), QStringLiteral("\\bsigned\\b"),
-        QStringLiteral("\\bunsigned\\b"), QStringLiteral("\\bvoid\\b"),
-        QStringLiteral("\\boverride\\b"), QStringLiteral("\\bfinal\\b"),
-        QStringLiteral("\\bnullptr\\b"), QStringLiteral("\\btrue\\b"),
-        QStringLiteral("\\bfalse\\b"), QStringLiteral("\\bthis\\b")
-    };
-
-    for (const QString& pattern : keywordPatterns) {
-        rules.append({QRegularExpression(pattern), keywordFormat});
-    }
-
-    // Class names (after class or struct keyword)
-    rules.append({
-        QRegularExpression(QStringLiteral("\\b(?:class|struct)\\s+(\\w+)\\b")),
-        classFormat
-    });
+    formats[CodeLexer::Keyword].setForeground(keywordColor);
+    formats[CodeLexer::Keyword].setFontWeight(QFont::Bold);
 
-    // Single-line comments
-    rules.append({
-        QRegularExpression(QStringLiteral("//[^\n]*")),
-        singleLineCommentFormat
-    });
+    formats[CodeLexer::ClassName].setForeground(classColor);
 
-    // Quotation
-    rules.append({
-        QRegularExpression(QStringLiteral("\".*\"")),
-        quotationFormat
-    });
+    formats[CodeLexer::Comment].setForeground(commentColor);
 
-    // Functions
-    rules.append({
-        QRegularExpression(QStringLiteral("\\b[A-Za-z0-9_]+(?=\\()")),
-        functionFormat
-    });
+    formats[CodeLexer::String].setForeground(stringColor);
+    
+    formats[CodeLexer::Function].setForeground(functionColor);
+    
+    formats[CodeLexer::Number].setForeground(numberColor);
+    
+    formats[CodeLexer::Preprocessor].setForeground(preprocessorColor);
+    
+    formats[CodeLexer::Decorator].setForeground(decoratorColor);
+}
 
-    // Numbers
-    rules.append({
-        QRegularExpression(QStringLiteral("\\b\\d+\\.?\\d*\\b")),
-        numberFormat
-    });
+void CodeHighlighter::setLanguage(Language lang) {
+    currentLanguage = lang;
+    startLazyRehighlight();
+}
 
-    // Preprocessor
-    rules.append({
-        QRegularExpression(QStringLiteral("#[a-zA-Z_][a-zA-Z0-9_]*\\b")),
-        preprocessorFormat
-    });
+void CodeHighlighter::updateTheme(bool isDarkMode) {
+    // Only the format table changes; blocks pick it up as they are shown
+    setupFormats(isDarkMode);
+    ++themeGeneration;
+    recolorVisible();
 }
 
-void CodeHighlighter::setupPythonRules() {
-    rules.clear();
-
-    // Keywords
-    const QString keywordPatterns[] = {
-        QStringLiteral("\\bFalse\\b"), QStringLiteral("\\bNone\\b"),
-        QStringLiteral("\\bTrue\\b"), QStringLiteral("\\band\\b"),
-        QStringLiteral("\\bas\\b"), QStringLiteral("\\bassert\\b"),
-        QStringLiteral("\\bbreak\\b"), QStringLiteral("\\bclass\\b"),
-        QStringLiteral("\\bcontinue\\b"), QStringLiteral("\\bdef\\b"),
-        QStringLiteral("\\bdel\\b"), QStringLiteral("\\belif\\b"),
-        QStringLiteral("\\belse\\b"), QStringLiteral("\\bexcept\\b"),
-        QStringLiteral("\\bfinally\\b"), QStringLiteral("\\bfor\\b"),
-        QStringLiteral("\\bfrom\\b"), QStringLiteral("\\bglobal\\b"),
-        QStringLiteral("\\bif\\b"), QStringLiteral("\\bimport\\b"),
-        QStringLiteral("\\bin\\b"), QStringLiteral("\\bis\\b"),
-        QStringLiteral("\\blambda\\b"), QStringLiteral("\\bnonlocal\\b"),
-        QStringLiteral("\\bnot\\b"), QStringLiteral("\\bor\\b"),
-        QStringLiteral("\\bpass\\b"), QStringLiteral("\\braise\\b"),
-        QStringLiteral("\\breturn\\b"), QStringLiteral("\\btry\\b"),
-        QStringLiteral("\\bwhile\\b"), QStringLiteral("\\bwith\\b"),
-        QStringLiteral("\\byield\\b")
-    };
-
-    for (const QString& pattern : keywordPatterns) {
-        rules.append({QRegularExpression(pattern), keywordFormat});
-    }
-
-    // Class names
-    rules.append({
-        QRegularExpression(QStringLiteral("\\bclass\\s+(\\w+)\\b")),
-        classFormat
-    });
+void CodeHighlighter::recolorVisible() {
+    updateVisibleRange();
+    if (currentLanguage == None || visibleFirst < 0) return;
+    
+    inPass = true;
+    recoloring = true;
+    QTextBlock block = document()->findBlockByNumber(visibleFirst);
+    for (int number = visibleFirst; block.isValid() && number <= visibleLast; ++number) {
+        if (!pending.isNull() && block.position() >= pending.position()) break;  // Still up to the pass
+        
+        const TokenData* data = static_cast<const TokenData*>(block.userData());
+        if (data && data->themeGeneration != themeGeneration) {
+            rehighlightBlock(block);
+        }
+        block = block.next();
+    }
+    recoloring = false;
+    inPass = false;
+}
 
-    // Single-line comments
-    rules.append({
-        QRegularExpression(QStringLiteral("#[^\n]*")),
-        singleLineCommentFormat
-    });
+CodeLexer::Language CodeHighlighter::lexerLanguage() const {
+    switch (currentLanguage) {
+        case CPP:
+            return CodeLexer::CPP;
+        case Python:
+            return CodeLexer::Python;
+        default:
+            return CodeLexer::None;
+    }
+}
 
-    // Decorators
-    rules.append({
-        QRegularExpression(QStringLiteral("@\\w+\\b")),
-        decoratorFormat
-    });
+void CodeHighlighter::startLazyRehighlight() {
+    if (!document()) return;
+    
+    pending = QTextCursor(document());
+    pending.setKeepPositionOnInsert(true);
+    restartLexing();
+    
+    // The viewport is done right away so the first paint is already correct
+    highlightVisible();
+    idleTimer->start();
+}
 
-    // String literals (single and double quotes)
-    rules.append({
-        QRegularExpression(QStringLiteral("(['\"]).*\\1")),
-        quotationFormat
-    });
+void CodeHighlighter::rehighlightFrom(int position) {
+    if (!document() || currentLanguage == None) return;
+    
+    // Called ahead of a large programmatic edit: with a pass pending from
+    // the first changed block, the edit's contentsChange only reformats
+    // the blocks in view and the pass takes care of the rest
+    const int start = document()->findBlock(position).position();
+    if (!pending.isNull() && pending.position() <= start) return;
+    
+    pending = QTextCursor(document());
+    pending.setPosition(start);
+    pending.setKeepPositionOnInsert(true);
+    updateVisibleRange();
+    restartLexing();
+    scheduleVisible();
+}
 
-    // Functions
-    rules.append({
-        QRegularExpression(QStringLiteral("\\bdef\\s+(\\w+)\\b")),
-        functionFormat
-    });
+void CodeHighlighter::suspend(int position) {
+    if (!document() || currentLanguage == None) return;
+    
+    // A bulk edit changes the document without telling us until it is
+    // done. Blocks from its start on are left to a pass, which holds
+    // still until resume(), so nothing is formatted from stale lines.
+    suspended = true;
+    idleTimer->stop();
+    lexer->cancel();
+    const int start = document()->findBlock(position).position();
+    if (pending.isNull() || pending.position() > start) {
+        pending = QTextCursor(document());
+        pending.setPosition(start);
+        pending.setKeepPositionOnInsert(true);
+    }
+}
 
-    // Numbers
-    rules.append({
-        QRegularExpression(QStringLiteral("\\b\\d+\\.?\\d*\\b")),
-        numberFormat
-    });
+void CodeHighlighter::resume() {
+    if (!suspended) return;
+    
+    // Whatever the worker had queued predates the edit
+    suspended = false;
+    restartLexing();
+    scheduleVisible();
 }
 
-void CodeHighlighter::setLanguage(Language lang) {
-    currentLanguage = lang;
-    setupFormats(QApplication::styleHints()->colorScheme() == Qt::ColorScheme::Dark);
+void CodeHighlighter::restartLexing() {
+    restartPending = false;
+    ready.clear();
+    readyLine = 0;
+    linesInFlight = 0;
     
-    switch (currentLanguage) {
-        case CPP:
-            setupCPPRules();
-            break;
-        case Python:
-            setupPythonRules();
-            break;
-        default:
-            rules.clear();
-            break;
+    if (pending.isNull() || currentLanguage == None) {
+        lexer->cancel();
+        nextSnapshot = QTextBlock();
+        return;
     }
     
-    rehighlight();
+    // The worker picks up where the pass is, from the state of the last
+    // block the pass has finished
+    nextSnapshot = pending.block();
+    const QTextBlock previous = nextSnapshot.previous();
+    lexer->start(lexerLanguage(), previous.isValid() ? qMax(previous.userState(), 0) : CodeLexer::NormalState);
 }
 
-void CodeHighlighter::updateTheme(bool isDarkMode) {
-    setupFormats(isDarkMode);
-    if (currentLanguage != None) {
-        setLanguage(currentLanguage);  // This will also call rehighlight()
+void CodeHighlighter::handleContentsChange(int position, int charsRemoved, int charsAdded) {
+    Q_UNUSED(charsRemoved);
+    if (inPass || pending.isNull()) return;
+    
+    // Lines the worker already has may no longer line up with the blocks
+    // the pass has left, so its output is stale from here on
+    if (position + charsAdded >= pending.position()) {
+        restartPending = true;
+        idleTimer->start();
     }
 }
 
-void CodeHighlighter::highlightBlock(const QString& text) {
-    // Apply regular expression rules
-    for (const HighlightRule& rule : rules) {
-        QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
-        while (matchIterator.hasNext()) {
-            QRegularExpressionMatch match = matchIterator.next();
-            setFormat(match.capturedStart(), match.capturedLength(), rule.format);
+void CodeHighlighter::handleBatch(const BackgroundLexer::Batch& batch) {
+    if (pending.isNull()) return;
+    
+    ready.append(batch);
+    idleTimer->start();
+}
+
+void CodeHighlighter::scheduleVisible() {
+    if (pending.isNull()) return;
+    
+    visibleDirty = true;
+    idleTimer->start();
+}
+
+void CodeHighlighter::updateVisibleRange() {
+    if (!editor) {
+        visibleFirst = visibleLast = -1;
+        return;
+    }
+    
+    const QRect rect = editor->viewport()->rect();
+    visibleFirst = editor->cursorForPosition(rect.topLeft()).blockNumber();
+    visibleLast = editor->cursorForPosition(rect.bottomRight()).blockNumber();
+}
+
+void CodeHighlighter::highlightVisible() {
+    visibleDirty = false;
+    updateVisibleRange();
+    if (pending.isNull() || visibleFirst < 0) return;
+    
+    inPass = true;
+    QTextBlock block = document()->findBlockByNumber(visibleFirst);
+    for (int number = visibleFirst; block.isValid() && number <= visibleLast; ++number) {
+        if (block.position() >= pending.position()) {
+            rehighlightBlock(block);
+        }
+        block = block.next();
+    }
+    inPass = false;
+}
+
+void CodeHighlighter::submitSnapshots(const QElapsedTimer& timer) {
+    // Copy the next lines out of the document for the worker, staying a
+    // bounded distance ahead of the pass
+    while (nextSnapshot.isValid() && linesInFlight < maxLinesAhead && !timer.hasExpired(frameBudgetMs)) {
+        QStringList lines;
+        lines.reserve(snapshotBatchLines);
+        for (; nextSnapshot.isValid() && lines.size() < snapshotBatchLines; nextSnapshot = nextSnapshot.next()) {
+            lines.append(nextSnapshot.text());
         }
+        linesInFlight += lines.size();
+        lexer->submit(lines);
     }
+}
 
-    // Handle multi-line comments for C++
-    if (currentLanguage == CPP) {
-        setCurrentBlockState(0);
-        int startIndex = 0;
+void CodeHighlighter::continueHighlighting() {
+    if (suspended) return;
+    
+    QElapsedTimer timer;
+    timer.start();
+    
+    if (restartPending) {
+        restartLexing();
+    }
+    if (visibleDirty) {
+        highlightVisible();
+    }
+    submitSnapshots(timer);
+    
+    // Advance the pass block by block until this slice's budget is spent.
+    // With a language set, the pass only moves over lines the worker has
+    // already lexed; the UI thread just applies their formats.
+    inPass = true;
+    while (!pending.isNull() && !timer.hasExpired(frameBudgetMs)) {
+        if (currentLanguage != None && ready.isEmpty()) break;
+        
+        const QTextBlock block = pending.block();
+        const QTextBlock next = block.next();
+        if (next.isValid()) {
+            pending.setPosition(next.position());
+        } else {
+            pending = QTextCursor();
+        }
         
-        if (previousBlockState() != 1) {
-            startIndex = text.indexOf(cppCommentStartExp);
+        if (!ready.isEmpty()) {
+            precomputed = &ready.first();
+            precomputedLine = readyLine;
+            precomputedPosition = block.position();
         }
+        rehighlightBlock(block);
+        precomputed = nullptr;
+        
+        if (!ready.isEmpty() && ++readyLine == ready.first().lineCount) {
+            ready.removeFirst();
+            readyLine = 0;
+        }
+        --linesInFlight;
+    }
+    inPass = false;
+    
+    if (pending.isNull()) {
+        restartLexing();  // Pass complete; drops the worker and its leftovers
+        return;
+    }
+    
+    // Otherwise come back for more now, or once the worker delivers
+    if (!ready.isEmpty() || currentLanguage == None
+        || (nextSnapshot.isValid() && linesInFlight < maxLinesAhead)) {
+        idleTimer->start();
+    }
+}
 
-        while (startIndex >= 0) {
-            QRegularExpressionMatch match = cppCommentEndExp.match(text, startIndex);
-            int endIndex = match.capturedStart();
-            int commentLength;
-            
-            if (endIndex == -1) {
-                setCurrentBlockState(1);
-                commentLength = text.length() - startIndex;
-            } else {
-                commentLength = endIndex - startIndex + match.capturedLength();
-            }
-            
-            setFormat(startIndex, commentLength, multiLineCommentFormat);
-            startIndex = text.indexOf(cppCommentStartExp, startIndex + commentLength);
+void CodeHighlighter::highlightBlock(const QString& text) {
+    LatencyMonitor::Scope scope(LatencyMonitor::Highlight);
+    const QTextBlock block = currentBlock();
+    
+    // While a lazy pass runs, blocks it hasn't reached keep their old state.
+    // That stops QSyntaxHighlighter from cascading a state change through
+    // the rest of the document in one go; the pass fixes them up in order.
+    if (!pending.isNull() && block.position() >= pending.position()) {
+        const int number = block.blockNumber();
+        if (number < visibleFirst || number > visibleLast) {
+            return;
         }
     }
+    
+    if (currentLanguage == None) {
+        setCurrentBlockUserData(nullptr);
+        setCurrentBlockState(CodeLexer::NormalState);
+        return;
+    }
+    
+    const int entryState = qMax(previousBlockState(), 0);
+    TokenData* data = static_cast<TokenData*>(currentBlockUserData());
+    if (!data) {
+        data = new TokenData;
+        setCurrentBlockUserData(data);
+    }
+    
+    if (recoloring && data->entryState == entryState) {
+        // Theme change only: the stored tokens still describe this block
+    } else if (precomputed && block.position() == precomputedPosition
+               && precomputed->states[precomputedLine] == entryState) {
+        // Tokens from the worker are used as long as they were lexed from
+        // the state this block actually starts in
+        const int begin = precomputed->tokenBegin(precomputedLine);
+        data->tokens = precomputed->tokens.mid(begin, precomputed->tokenEnds[precomputedLine] - begin);
+        data->exitState = precomputed->states[precomputedLine + 1];
+    } else {
+        // One linear pass per line; multi-line constructs ride on the block state
+        data->tokens.clear();
+        data->exitState = CodeLexer::lexLine(lexerLanguage(), text, entryState, data->tokens);
+    }
+    data->entryState = entryState;
+    data->themeGeneration = themeGeneration;
+    
+    for (const CodeLexer::Token& token : std::as_const(data->tokens)) {
+        setFormat(token.start, token.length, formats[token.kind]);
+    }
+    setCurrentBlockState(data->exitState);
 }
@@ -2,9 +2,23 @@
 
 #include <QSyntaxHighlighter>
 #include <QTextCharFormat>
-#include <QRegularExpression>
-#include <QHash>
+#include <QTextCursor>
+#include <QTextBlock>
+#include <QList>
+#include <QPointer>
+#include <QVector>
+#include "code_lexer.h"
+#include "background_lexer.h"
 
+class QPlainTextEdit;
+class QTimer;
+class QElapsedTimer;
+
+// Full rehighlights (language or theme changes) are lazy: the blocks in the
+// editor's viewport are done first and the rest of the document follows in
+// time-sliced chunks from the event loop, so no single step takes longer
+// than a frame. During a pass the lexing itself runs on a BackgroundLexer
+// and the UI thread only applies the resulting formats.
 class CodeHighlighter : public QSyntaxHighlighter {
     Q_OBJECT
 
@@ -16,37 +30,66 @@ public:
     };
 
     explicit CodeHighlighter(QTextDocument* parent = nullptr);
+    void setEditor(QPlainTextEdit* editor);
     void setLanguage(Language lang);
     void updateTheme(bool isDarkMode);
+    void rehighlightFrom(int position);
+    void suspend(int position);
+    void resume();
+    bool isHighlighting() const { return !pending.isNull(); }  // A lazy pass is still running
 
 protected:
     void highlightBlock(const QString& text) override;
+    bool eventFilter(QObject* obj, QEvent* event) override;
+
+private slots:
+    void scheduleVisible();
+    void continueHighlighting();
+    void handleContentsChange(int position, int charsRemoved, int charsAdded);
+    void handleBatch(const BackgroundLexer::Batch& batch);
+    void handleViewportChange();
 
 private:
-    void setupCPPRules();
-    void setupPythonRules();
     void setupFormats(bool isDarkMode);
-
-    struct HighlightRule {
-        QRegularExpression pattern;
-        QTextCharFormat format;
-    };
+    void startLazyRehighlight();
+    void restartLexing();
+    void submitSnapshots(const QElapsedTimer& timer);
+    void highlightVisible();
+    void updateVisibleRange();
+    void recolorVisible();
+    CodeLexer::Language lexerLanguage() const;
 
     Language currentLanguage;
-    QVector<HighlightRule> rules;
-    
-    // Multi-line comment handling
-    QRegularExpression cppCommentStartExp;
-    QRegularExpression cppCommentEndExp;
-    QTextCharFormat multiLineCommentFormat;
-
-    // Common formats
-    QTextCharFormat keywordFormat;
-    QTextCharFormat classFormat;
-    QTextCharFormat singleLineCommentFormat;
-    QTextCharFormat quotationFormat;
-    QTextCharFormat functionFormat;
-    QTextCharFormat numberFormat;
-    QTextCharFormat preprocessorFormat;  // For C/C++
-    QTextCharFormat decoratorFormat;     // For Python
+
+    // Format for each CodeLexer::TokenKind. Blocks keep their token kinds,
+    // so a theme change swaps this table and recolors only what is shown.
+    QTextCharFormat formats[CodeLexer::TokenKindCount];
+    bool recoloring;      // Reapplying stored tokens with a new theme
+    int themeGeneration;  // Bumped on every theme change
+
+    // Lazy rehighlight state. Blocks from 'pending' on haven't been redone
+    // yet; the cursor is null when no pass is running.
+    QPointer<QPlainTextEdit> editor;
+    QTimer* idleTimer;
+    QTextCursor pending;
+    int visibleFirst;
+    int visibleLast;
+    bool visibleDirty;
+    bool inPass;          // Set while the highlighter itself is reformatting blocks
+    bool restartPending;  // An edit reached the part the worker is lexing
+    bool suspended;       // A bulk edit is under way; the pass waits for it
+    const int frameBudgetMs = 8;
+
+    // Worker side of the pass. Lines from nextSnapshot on haven't been sent
+    // yet; ready holds lexed lines in block order starting at 'pending'.
+    BackgroundLexer* lexer;
+    QTextBlock nextSnapshot;
+    QList<BackgroundLexer::Batch> ready;
+    int readyLine;
+    int linesInFlight;
+    const BackgroundLexer::Batch* precomputed;  // Tokens for the block being reformatted
+    int precomputedLine;
+    int precomputedPosition;
+    const int snapshotBatchLines = 4096;
+    const int maxLinesAhead = 64 * 1024;
 };
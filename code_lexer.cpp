@@ -0,0 +1,486 @@
+#include "code_lexer.h"
+#include <QHash>
+#include <algorithm>
+
+namespace {
+// Line-end states. The low byte is the construct; raw strings keep a hash
+// of their delimiter in the bits above it.
+enum State {
+    Normal = CodeLexer::NormalState,
+    BlockComment = 1,
+    LineCommentContinued,
+    StringContinued,
+    PreprocessorContinued,
+    RawString,
+    TripleDouble,
+    TripleSingle,
+    DoubleContinued,
+    SingleContinued
+};
+
+const int maxRawDelimiter = 16;
+
+// Keyword tables, kept sorted for binary search
+const QLatin1String cppKeywords[] = {
+    QLatin1String("auto"), QLatin1String("bool"), QLatin1String("break"),
+    QLatin1String("case"), QLatin1String("catch"), QLatin1String("char"),
+    QLatin1String("class"), QLatin1String("const"), QLatin1String("continue"),
+    QLatin1String("default"), QLatin1String("delete"), QLatin1String("do"),
+    QLatin1String("double"), QLatin1String("else"), QLatin1String("enum"),
+    QLatin1String("explicit"), QLatin1String("false"), QLatin1String("final"),
+    QLatin1String("float"), QLatin1String("for"), QLatin1String("friend"),
+    QLatin1String("goto"), QLatin1String("if"), QLatin1String("inline"),
+    QLatin1String("int"), QLatin1String("long"), QLatin1String("namespace"),
+    QLatin1String("new"), QLatin1String("nullptr"), QLatin1String("operator"),
+    QLatin1String("override"), QLatin1String("private"),
+    QLatin1String("protected"), QLatin1String("public"), QLatin1String("return"),
+    QLatin1String("short"), QLatin1String("signals"), QLatin1String("signed"),
+    QLatin1String("slots"), QLatin1String("static"), QLatin1String("struct"),
+    QLatin1String("switch"), QLatin1String("template"), QLatin1String("this"),
+    QLatin1String("true"), QLatin1String("try"), QLatin1String("typedef"),
+    QLatin1String("typename"), QLatin1String("union"), QLatin1String("unsigned"),
+    QLatin1String("virtual"), QLatin1String("void"), QLatin1String("volatile"),
+    QLatin1String("while")
+};
+
+const QLatin1String pythonKeywords[] = {
+    QLatin1String("False"), QLatin1String("None"), QLatin1String("True"),
+    QLatin1String("and"), QLatin1String("as"), QLatin1String("assert"),
+    QLatin1String("break"), QLatin1String("class"), QLatin1String("continue"),
+    QLatin1String("def"), QLatin1String("del"), QLatin1String("elif"),
+    QLatin1String("else"), QLatin1String("except"), QLatin1String("finally"),
+    QLatin1String("for"), QLatin1String("from"), QLatin1String("global"),
+    QLatin1String("if"), QLatin1String("import"), QLatin1String("in"),
+    QLatin1String("is"), QLatin1String("lambda"), QLatin1String("nonlocal"),
+    QLatin1String("not"), QLatin1String("or"), QLatin1String("pass"),
+    QLatin1String("raise"), QLatin1String("return"), QLatin1String("try"),
+    QLatin1String("while"), QLatin1String("with"), QLatin1String("yield")
+};
+
+template <size_t N>
+bool isKeyword(const QLatin1String (&table)[N], QStringView word) {
+    auto it = std::lower_bound(std::begin(table), std::end(table), word,
+                               [](QLatin1String keyword, QStringView w) { return w.compare(keyword) > 0; });
+    return it != std::end(table) && word.compare(*it) == 0;
+}
+
+bool isWordChar(QChar ch) {
+    return ch.isLetterOrNumber() || ch == QLatin1Char('_');
+}
+
+bool endsWithBackslash(QStringView text) {
+    return text.endsWith(QLatin1Char('\\'));
+}
+
+int firstNonSpace(QStringView text) {
+    int i = 0;
+    while (i < text.size() && text[i].isSpace()) {
+        ++i;
+    }
+    return i;
+}
+
+// Index just past the closing quote, or -1 if the line ends inside the string
+int skipString(QStringView text, int from, QChar quote) {
+    for (int i = from; i < text.size(); ++i) {
+        if (text[i] == QLatin1Char('\\')) {
+            ++i;
+        } else if (text[i] == quote) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+int skipTripleString(QStringView text, int from, QChar quote) {
+    for (int i = from; i < text.size(); ++i) {
+        if (text[i] == QLatin1Char('\\')) {
+            ++i;
+        } else if (text[i] == quote && i + 2 < text.size()
+                   && text[i + 1] == quote && text[i + 2] == quote) {
+            return i + 3;
+        }
+    }
+    return -1;
+}
+
+int skipNumber(QStringView text, int from, bool digitSeparators) {
+    int i = from + 1;
+    while (i < text.size()) {
+        const QChar ch = text[i];
+        const QChar previous = text[i - 1];
+        if (isWordChar(ch) || ch == QLatin1Char('.') || (digitSeparators && ch == QLatin1Char('\''))) {
+            ++i;
+        } else if ((ch == QLatin1Char('+') || ch == QLatin1Char('-'))
+                   && (previous == QLatin1Char('e') || previous == QLatin1Char('E')
+                       || previous == QLatin1Char('p') || previous == QLatin1Char('P'))) {
+            ++i;
+        } else {
+            break;
+        }
+    }
+    return i;
+}
+
+int rawDelimiterHash(QStringView delimiter) {
+    return int(qHash(delimiter) & 0x7FFFFF);
+}
+
+// Index just past the )delimiter" that closes a raw string, or -1
+int skipRawString(QStringView text, int from, int delimiterHash) {
+    for (int i = text.indexOf(QLatin1Char(')'), from); i >= 0; i = text.indexOf(QLatin1Char(')'), i + 1)) {
+        const int quote = text.indexOf(QLatin1Char('"'), i + 1);
+        if (quote < 0) return -1;
+        if (quote - i - 1 <= maxRawDelimiter
+            && rawDelimiterHash(text.mid(i + 1, quote - i - 1)) == delimiterHash) {
+            return quote + 1;
+        }
+    }
+    return -1;
+}
+
+bool isCppStringPrefix(QStringView word) {
+    static const QLatin1String prefixes[] = {
+        QLatin1String("L"), QLatin1String("LR"), QLatin1String("R"), QLatin1String("U"),
+        QLatin1String("UR"), QLatin1String("u"), QLatin1String("u8"), QLatin1String("u8R"),
+        QLatin1String("uR")
+    };
+    return isKeyword(prefixes, word);
+}
+
+bool isPythonStringPrefix(QStringView word) {
+    if (word.size() > 2) return false;
+    for (QChar ch : word) {
+        const char c = ch.toLower().toLatin1();
+        if (c != 'r' && c != 'b' && c != 'f' && c != 'u') return false;
+    }
+    return true;
+}
+
+class Lexer {
+public:
+    Lexer(QStringView text, QVector<CodeLexer::Token>& tokens)
+        : text(text)
+        , length(text.size())
+        , tokens(tokens)
+    {
+    }
+
+    int lexCpp(int state);
+    int lexPython(int state);
+
+private:
+    void add(int start, int end, CodeLexer::TokenKind kind) {
+        tokens.append({start, end - start, kind});
+    }
+
+    QStringView text;
+    int length;
+    QVector<CodeLexer::Token>& tokens;
+};
+
+int Lexer::lexCpp(int state) {
+    int i = 0;
+    bool directive = false;
+
+    // Resume whatever construct the previous line left open
+    switch (state & 0xFF) {
+        case BlockComment: {
+            const int end = text.indexOf(QLatin1String("*/"));
+            if (end < 0) {
+                add(0, length, CodeLexer::Comment);
+                return BlockComment;
+            }
+            add(0, end + 2, CodeLexer::Comment);
+            i = end + 2;
+            break;
+        }
+        case LineCommentContinued:
+            add(0, length, CodeLexer::Comment);
+            return endsWithBackslash(text) ? LineCommentContinued : Normal;
+        case StringContinued: {
+            const int end = skipString(text, 0, QLatin1Char('"'));
+            if (end < 0) {
+                add(0, length, CodeLexer::String);
+                return endsWithBackslash(text) ? StringContinued : Normal;
+            }
+            add(0, end, CodeLexer::String);
+            i = end;
+            break;
+        }
+        case RawString: {
+            const int end = skipRawString(text, 0, state >> 8);
+            if (end < 0) {
+                add(0, length, CodeLexer::String);
+                return state;
+            }
+            add(0, end, CodeLexer::String);
+            i = end;
+            break;
+        }
+        case PreprocessorContinued:
+            directive = true;
+            break;
+        default:
+            break;
+    }
+
+    const int lineStart = firstNonSpace(text);
+    bool expectClassName = false;
+
+    while (i < length) {
+        const QChar ch = text[i];
+
+        if (ch.isSpace()) {
+            ++i;
+            continue;
+        }
+
+        // Comments
+        if (ch == QLatin1Char('/') && i + 1 < length) {
+            if (text[i + 1] == QLatin1Char('/')) {
+                add(i, length, CodeLexer::Comment);
+                return endsWithBackslash(text) ? LineCommentContinued : Normal;
+            }
+            if (text[i + 1] == QLatin1Char('*')) {
+                const int end = text.indexOf(QLatin1String("*/"), i + 2);
+                if (end < 0) {
+                    add(i, length, CodeLexer::Comment);
+                    return BlockComment;
+                }
+                add(i, end + 2, CodeLexer::Comment);
+                i = end + 2;
+                continue;
+            }
+        }
+
+        // Preprocessor directives, including the <header> of an #include
+        if (ch == QLatin1Char('#') && i == lineStart) {
+            directive = true;
+            int end = i + 1;
+            while (end < length && text[end].isSpace()) ++end;
+            const int nameStart = end;
+            while (end < length && isWordChar(text[end])) ++end;
+            add(i, end, CodeLexer::Preprocessor);
+            i = end;
+
+            if (text.mid(nameStart, end - nameStart) == QLatin1String("include")) {
+                while (i < length && text[i].isSpace()) ++i;
+                if (i < length && text[i] == QLatin1Char('<')) {
+                    const int close = text.indexOf(QLatin1Char('>'), i);
+                    if (close > 0) {
+                        add(i, close + 1, CodeLexer::String);
+                        i = close + 1;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // Identifiers, keywords and prefixed string literals
+        if (ch.isLetter() || ch == QLatin1Char('_')) {
+            int end = i + 1;
+            while (end < length && isWordChar(text[end])) ++end;
+            const QStringView word = text.mid(i, end - i);
+
+            if (end < length && (text[end] == QLatin1Char('"') || text[end] == QLatin1Char('\''))
+                && isCppStringPrefix(word)) {
+                if (word.endsWith(QLatin1Char('R')) && text[end] == QLatin1Char('"')) {
+                    const int open = text.indexOf(QLatin1Char('('), end + 1);
+                    if (open >= 0 && open - end - 1 <= maxRawDelimiter) {
+                        const int hash = rawDelimiterHash(text.mid(end + 1, open - end - 1));
+                        const int close = skipRawString(text, open + 1, hash);
+                        if (close < 0) {
+                            add(i, length, CodeLexer::String);
+                            return RawString | (hash << 8);
+                        }
+                        add(i, close, CodeLexer::String);
+                        i = close;
+                        continue;
+                    }
+                }
+                const int close = skipString(text, end + 1, text[end]);
+                if (close < 0) {
+                    add(i, length, CodeLexer::String);
+                    return text[end] == QLatin1Char('"') && endsWithBackslash(text) ? StringContinued : Normal;
+                }
+                add(i, close, CodeLexer::String);
+                i = close;
+                continue;
+            }
+
+            if (expectClassName) {
+                add(i, end, CodeLexer::ClassName);
+                expectClassName = false;
+            } else if (isKeyword(cppKeywords, word)) {
+                add(i, end, CodeLexer::Keyword);
+                expectClassName = word == QLatin1String("class") || word == QLatin1String("struct");
+            } else if (end < length && text[end] == QLatin1Char('(')) {
+                add(i, end, CodeLexer::Function);
+            }
+            i = end;
+            continue;
+        }
+
+        expectClassName = false;
+
+        // String and character literals
+        if (ch == QLatin1Char('"') || ch == QLatin1Char('\'')) {
+            const int end = skipString(text, i + 1, ch);
+            if (end < 0) {
+                add(i, length, CodeLexer::String);
+                if (ch == QLatin1Char('"') && endsWithBackslash(text)) return StringContinued;
+                break;
+            }
+            add(i, end, CodeLexer::String);
+            i = end;
+            continue;
+        }
+
+        // Numbers
+        if (ch.isDigit() || (ch == QLatin1Char('.') && i + 1 < length && text[i + 1].isDigit())) {
+            const int end = skipNumber(text, i, true);
+            add(i, end, CodeLexer::Number);
+            i = end;
+            continue;
+        }
+
+        ++i;
+    }
+
+    return directive && endsWithBackslash(text) ? PreprocessorContinued : Normal;
+}
+
+int Lexer::lexPython(int state) {
+    int i = 0;
+
+    // Resume whatever string the previous line left open
+    switch (state & 0xFF) {
+        case TripleDouble:
+        case TripleSingle: {
+            const QChar quote = (state & 0xFF) == TripleDouble ? QLatin1Char('"') : QLatin1Char('\'');
+            const int end = skipTripleString(text, 0, quote);
+            if (end < 0) {
+                add(0, length, CodeLexer::String);
+                return state;
+            }
+            add(0, end, CodeLexer::String);
+            i = end;
+            break;
+        }
+        case DoubleContinued:
+        case SingleContinued: {
+            const QChar quote = (state & 0xFF) == DoubleContinued ? QLatin1Char('"') : QLatin1Char('\'');
+            const int end = skipString(text, 0, quote);
+            if (end < 0) {
+                add(0, length, CodeLexer::String);
+                return endsWithBackslash(text) ? state : Normal;
+            }
+            add(0, end, CodeLexer::String);
+            i = end;
+            break;
+        }
+        default:
+            break;
+    }
+
+    int nameKind = -1;  // Kind of the identifier following 'class' or 'def'
+
+    while (i < length) {
+        const QChar ch = text[i];
+
+        if (ch.isSpace()) {
+            ++i;
+            continue;
+        }
+
+        if (ch == QLatin1Char('#')) {
+            add(i, length, CodeLexer::Comment);
+            return Normal;
+        }
+
+        // Strings, with an optional r/b/f/u prefix
+        int quote = -1;
+        int end = i;
+        if (ch.isLetter() || ch == QLatin1Char('_')) {
+            while (end < length && isWordChar(text[end])) ++end;
+            if (end < length && (text[end] == QLatin1Char('"') || text[end] == QLatin1Char('\''))
+                && isPythonStringPrefix(text.mid(i, end - i))) {
+                quote = end;
+            }
+        } else if (ch == QLatin1Char('"') || ch == QLatin1Char('\'')) {
+            quote = i;
+        }
+
+        if (quote >= 0) {
+            const QChar q = text[quote];
+            const bool triple = quote + 2 < length && text[quote + 1] == q && text[quote + 2] == q;
+            const int close = triple ? skipTripleString(text, quote + 3, q) : skipString(text, quote + 1, q);
+            if (close < 0) {
+                add(i, length, CodeLexer::String);
+                if (triple) return q == QLatin1Char('"') ? TripleDouble : TripleSingle;
+                if (endsWithBackslash(text)) return q == QLatin1Char('"') ? DoubleContinued : SingleContinued;
+                return Normal;
+            }
+            add(i, close, CodeLexer::String);
+            i = close;
+            nameKind = -1;
+            continue;
+        }
+
+        // Identifiers and keywords
+        if (end > i) {
+            const QStringView word = text.mid(i, end - i);
+            if (nameKind >= 0) {
+                add(i, end, CodeLexer::TokenKind(nameKind));
+                nameKind = -1;
+            } else if (isKeyword(pythonKeywords, word)) {
+                add(i, end, CodeLexer::Keyword);
+                if (word == QLatin1String("class")) {
+                    nameKind = CodeLexer::ClassName;
+                } else if (word == QLatin1String("def")) {
+                    nameKind = CodeLexer::Function;
+                }
+            }
+            i = end;
+            continue;
+        }
+
+        nameKind = -1;
+
+        // Decorators
+        if (ch == QLatin1Char('@') && i + 1 < length
+            && (text[i + 1].isLetter() || text[i + 1] == QLatin1Char('_'))) {
+            end = i + 1;
+            while (end < length && (isWordChar(text[end]) || text[end] == QLatin1Char('.'))) ++end;
+            add(i, end, CodeLexer::Decorator);
+            i = end;
+            continue;
+        }
+
+        // Numbers
+        if (ch.isDigit() || (ch == QLatin1Char('.') && i + 1 < length && text[i + 1].isDigit())) {
+            end = skipNumber(text, i, false);
+            add(i, end, CodeLexer::Number);
+            i = end;
+            continue;
+        }
+
+        ++i;
+    }
+
+    return Normal;
+}
+}
+
+int CodeLexer::lexLine(Language language, QStringView text, int state, QVector<Token>& tokens) {
+    Lexer lexer(text, tokens);
+    switch (language) {
+        case CPP:
+            return lexer.lexCpp(qMax(state, 0));
+        case Python:
+            return lexer.lexPython(qMax(state, 0));
+        default:
+            return NormalState;
+    }
+}
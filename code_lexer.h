@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QStringView>
+#include <QVector>
+
+// Hand-written line lexer for the highlighted languages. Each line is
+// tokenized in a single linear scan; constructs that span lines (block
+// comments, raw strings, triple-quoted strings, continuation lines) are
+// carried in the returned state, which is fed back in for the next line.
+// Everything here is stateless and safe to call from any thread.
+class CodeLexer {
+public:
+    enum Language {
+        None,
+        CPP,
+        Python
+    };
+
+    enum TokenKind : quint8 {
+        Keyword,
+        ClassName,
+        Comment,
+        String,
+        Function,
+        Number,
+        Preprocessor,
+        Decorator,
+        TokenKindCount
+    };
+
+    struct Token {
+        int start;
+        int length;
+        TokenKind kind;
+    };
+
+    // State of a line that ends outside any multi-line construct
+    static const int NormalState = 0;
+
+    // Appends the tokens of one line to tokens and returns the state the
+    // next line starts in. Text not covered by a token is plain.
+    static int lexLine(Language language, QStringView text, int state, QVector<Token>& tokens);
+};
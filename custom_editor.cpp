@@ -1,10 +1,164 @@
 #include "custom_editor.h"
+#include "latency_monitor.h"
+#include "startup_profile.h"
+#include "undo_history.h"
+#include "bulk_inserter.h"
+#include <QContextMenuEvent>
+#include <QDropEvent>
+#include <QInputMethodEvent>
+#include <QKeyEvent>
+#include <QMenu>
+#include <QMimeData>
+#include <QPlainTextDocumentLayout>
+#include <QTextDocument>
+
+namespace {
+// Plain text layout that reports relayout work to the latency monitor
+class TimedDocumentLayout : public QPlainTextDocumentLayout {
+public:
+    explicit TimedDocumentLayout(QTextDocument* document)
+        : QPlainTextDocumentLayout(document)
+    {
+    }
+
+protected:
+    void documentChanged(int from, int charsRemoved, int charsAdded) override {
+        LatencyMonitor::Scope scope(LatencyMonitor::Layout);
+        QPlainTextDocumentLayout::documentChanged(from, charsRemoved, charsAdded);
+    }
+};
+}
 
 CustomEditor::CustomEditor(QWidget* parent)
     : QPlainTextEdit(parent)
 {
+    QTextDocument* document = new QTextDocument(this);
+    document->setDocumentLayout(new TimedDocumentLayout(document));
+    setDocument(document);
+    
+    // The document's stack would keep every edit; this one is bounded
+    document->setUndoRedoEnabled(false);
+    history = new UndoHistory(document, this);
+    
+    // Large insertions are read-only until complete, then shown like a paste
+    inserter = new BulkInserter(document, this);
+    connect(inserter, &BulkInserter::started, this, [this] {
+        setReadOnly(true);
+    });
+    connect(inserter, &BulkInserter::finished, this, [this] {
+        setReadOnly(false);
+        ensureCursorVisible();
+    });
 }
 
 void CustomEditor::setCustomViewportMargins(int left, int top, int right, int bottom) {
     setViewportMargins(left, top, right, bottom);
 }
+
+void CustomEditor::keyPressEvent(QKeyEvent* event) {
+    LatencyMonitor::Scope scope(LatencyMonitor::Edit);
+    if (event->matches(QKeySequence::Undo) || event->matches(QKeySequence::Redo)) {
+        applyHistory(event->matches(QKeySequence::Redo));
+        event->accept();
+        return;
+    }
+    if (mayEdit(event)) {
+        prepareEdit();
+    }
+    QPlainTextEdit::keyPressEvent(event);
+}
+
+bool CustomEditor::mayEdit(const QKeyEvent* event) {
+    switch (event->key()) {
+        case Qt::Key_Backspace:
+        case Qt::Key_Delete:
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+        case Qt::Key_Tab:
+        case Qt::Key_Backtab:
+            return true;
+        default:
+            break;
+    }
+    if (event->matches(QKeySequence::Cut) || event->matches(QKeySequence::Paste)
+        || event->matches(QKeySequence::DeleteStartOfWord) || event->matches(QKeySequence::DeleteEndOfWord)
+        || event->matches(QKeySequence::DeleteEndOfLine) || event->matches(QKeySequence::DeleteCompleteLine)) {
+        return true;
+    }
+    const QString text = event->text();
+    return !text.isEmpty() && text.at(0).isPrint();
+}
+
+void CustomEditor::prepareEdit() {
+    if (isReadOnly()) return;
+    
+    const QTextCursor cursor = textCursor();
+    history->capture(cursor.selectionStart() - editMargin, cursor.selectionEnd() + editMargin);
+}
+
+void CustomEditor::inputMethodEvent(QInputMethodEvent* event) {
+    prepareEdit();
+    QPlainTextEdit::inputMethodEvent(event);
+}
+
+void CustomEditor::dropEvent(QDropEvent* event) {
+    // A move within the editor removes the selection and inserts at the
+    // drop point in one change; capture the span of both
+    if (!isReadOnly()) {
+        const QTextCursor cursor = textCursor();
+        const int drop = cursorForPosition(event->position().toPoint()).position();
+        history->capture(qMin(cursor.selectionStart(), drop) - editMargin,
+                         qMax(cursor.selectionEnd(), drop) + editMargin);
+    }
+    QPlainTextEdit::dropEvent(event);
+}
+
+void CustomEditor::applyHistory(bool redo) {
+    if (isReadOnly()) return;
+    
+    QTextCursor cursor = textCursor();
+    if (redo ? history->redo(&cursor) : history->undo(&cursor)) {
+        setTextCursor(cursor);
+    }
+}
+
+void CustomEditor::contextMenuEvent(QContextMenuEvent* event) {
+    // The menu's Undo and Redo would go to the document's own stack, which
+    // is off; point them at the history instead
+    QMenu* menu = createStandardContextMenu(event->pos());
+    for (QAction* action : menu->actions()) {
+        const bool undo = action->objectName() == QLatin1String("edit-undo");
+        const bool redo = action->objectName() == QLatin1String("edit-redo");
+        if (!undo && !redo) continue;
+        
+        disconnect(action, &QAction::triggered, nullptr, nullptr);
+        action->setEnabled(undo ? history->canUndo() : history->canRedo());
+        connect(action, &QAction::triggered, this, [this, redo] { applyHistory(redo); });
+    }
+    prepareEdit();  // For Cut, Paste and Delete
+    menu->exec(event->globalPos());
+    delete menu;
+}
+
+void CustomEditor::insertFromMimeData(const QMimeData* source) {
+    // Paste and drop both land here; large text goes in through the bulk path
+    if (source->hasText()) {
+        const QString text = source->text();
+        if (text.size() >= bulkInsertThreshold) {
+            inserter->start(textCursor(), text);
+            return;
+        }
+    }
+    QPlainTextEdit::insertFromMimeData(source);
+}
+
+void CustomEditor::paintEvent(QPaintEvent* event) {
+    {
+        LatencyMonitor::Scope scope(LatencyMonitor::Paint);
+        QPlainTextEdit::paintEvent(event);
+    }
+    
+    // The first viewport paint after a key press completes that input
+    LatencyMonitor::instance().endInput();
+    StartupProfile::firstPaint();
+}
@@ -3,6 +3,8 @@
 #include <QPlainTextEdit>
 
 class LineNumberArea;  // Forward declaration
+class UndoHistory;
+class BulkInserter;
 
 class CustomEditor : public QPlainTextEdit {
     Q_OBJECT
@@ -10,10 +12,30 @@ class CustomEditor : public QPlainTextEdit {
 public:
     explicit CustomEditor(QWidget* parent = nullptr);
     void setCustomViewportMargins(int left, int top, int right, int bottom);
+    UndoHistory* undoHistory() const { return history; }
+    BulkInserter* bulkInserter() const { return inserter; }
+    void prepareEdit();  // Lets the history see what typing at the cursor replaces
 
     // Make these methods available to LineNumberArea
     friend class LineNumberArea;
     using QPlainTextEdit::blockBoundingGeometry;
     using QPlainTextEdit::contentOffset;
     using QPlainTextEdit::firstVisibleBlock;
+
+protected:
+    void keyPressEvent(QKeyEvent* event) override;
+    void paintEvent(QPaintEvent* event) override;
+    void insertFromMimeData(const QMimeData* source) override;
+    void contextMenuEvent(QContextMenuEvent* event) override;
+    void inputMethodEvent(QInputMethodEvent* event) override;
+    void dropEvent(QDropEvent* event) override;
+
+private:
+    void applyHistory(bool redo);
+    static bool mayEdit(const QKeyEvent* event);
+
+    UndoHistory* history;  // Replaces the document's own undo stack
+    BulkInserter* inserter;  // Takes pastes and drops of large text
+    const int bulkInsertThreshold = 64 * 1024;  // Characters
+    const int editMargin = 1024;  // Reaches past any word a key may delete
 };
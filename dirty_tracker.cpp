@@ -0,0 +1,139 @@
+#include "dirty_tracker.h"
+#include <QTextBlock>
+
+DirtyTracker::DirtyTracker(QTextDocument* document, QObject* parent)
+    : QObject(parent)
+    , document(document)
+    , mismatches(0)
+    , mismatchesValid(true)
+    , revision(0)
+    , dirty(false)
+{
+    rebuildHashes();
+    savedHashes = currentHashes;
+
+    connect(document, &QTextDocument::contentsChange,
+            this, &DirtyTracker::handleContentsChange);
+    connect(document, &QTextDocument::modificationChanged,
+            this, &DirtyTracker::updateDirty);
+}
+
+DirtyTracker::SavePoint DirtyTracker::savePoint() const {
+    return {currentHashes, revision};
+}
+
+void DirtyTracker::markSaved() {
+    markSaved(savePoint());
+}
+
+void DirtyTracker::markSaved(const SavePoint& point) {
+    savedHashes = point.hashes;
+    mismatchesValid = false;
+    
+    // Only clear the modified flag if the text didn't change since the
+    // snapshot. Otherwise it must be set even if the text is back to what
+    // it was before the save, since that is no longer what is on disk;
+    // the hashes then decide.
+    document->setModified(revision != point.textRevision);
+    updateDirty();
+}
+
+void DirtyTracker::rebuildHashes() {
+    currentHashes.clear();
+    currentHashes.reserve(document->blockCount());
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        currentHashes.append(qHash(block.text()));
+    }
+    mismatchesValid = false;
+}
+
+void DirtyTracker::handleContentsChange(int position, int charsRemoved, int charsAdded) {
+    Q_UNUSED(charsRemoved);
+
+    const int oldCount = currentHashes.size();
+    const int delta = document->blockCount() - oldCount;
+
+    // Blocks touched by the change, numbered in the new document
+    QTextBlock first = document->findBlock(position);
+    QTextBlock last = document->findBlock(position + charsAdded);
+    if (!first.isValid()) first = document->lastBlock();
+    if (!last.isValid()) last = document->lastBlock();
+
+    const int firstNumber = first.blockNumber();
+    const int newSpan = last.blockNumber() - firstNumber + 1;
+    const int oldSpan = newSpan - delta;
+
+    if (oldSpan < 0 || firstNumber + oldSpan > oldCount) {
+        // The reported range doesn't line up with what we hold; start over
+        rebuildHashes();
+        bumpRevision();
+        updateDirty();
+        return;
+    }
+
+    // Mismatch counting only holds while block indices line up with the
+    // saved snapshot, i.e. while the edit doesn't shift the following blocks
+    const bool aligned = delta == 0 && mismatchesValid && oldCount == savedHashes.size();
+
+    if (delta == 0) {
+        bool changed = false;
+        QTextBlock block = first;
+        for (int i = firstNumber; i < firstNumber + newSpan; ++i, block = block.next()) {
+            const size_t hash = qHash(block.text());
+            if (hash == currentHashes[i]) continue;
+
+            if (aligned) {
+                mismatches -= currentHashes[i] != savedHashes[i];
+                mismatches += hash != savedHashes[i];
+            }
+            currentHashes[i] = hash;
+            changed = true;
+        }
+
+        // Same hashes throughout: only formats changed
+        if (!changed) return;
+    } else {
+        currentHashes.remove(firstNumber, oldSpan);
+        currentHashes.insert(firstNumber, newSpan, 0);
+        QTextBlock block = first;
+        for (int i = firstNumber; i < firstNumber + newSpan; ++i, block = block.next()) {
+            currentHashes[i] = qHash(block.text());
+        }
+        mismatchesValid = false;
+    }
+
+    bumpRevision();
+    updateDirty();
+}
+
+void DirtyTracker::bumpRevision() {
+    ++revision;
+    emit textChanged();
+}
+
+void DirtyTracker::recountMismatches() {
+    mismatches = 0;
+    for (int i = 0; i < currentHashes.size(); ++i) {
+        mismatches += currentHashes[i] != savedHashes[i];
+    }
+    mismatchesValid = true;
+}
+
+bool DirtyTracker::matchesSavedHashes() {
+    // A different block count can never be the saved text
+    if (currentHashes.size() != savedHashes.size()) {
+        return false;
+    }
+    if (!mismatchesValid) {
+        recountMismatches();
+    }
+    return mismatches == 0;
+}
+
+void DirtyTracker::updateDirty() {
+    bool nowDirty = document->isModified() && !matchesSavedHashes();
+    if (nowDirty != dirty) {
+        dirty = nowDirty;
+        emit dirtyChanged(dirty);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QTextDocument>
+
+// Tracks whether a document differs from its last saved state without
+// touching the disk. QTextDocument::isModified answers whether anything
+// changed since the save; per-block content hashes catch edits, undo
+// included, that bring the text back to what was saved. The hashes also
+// tell text edits apart from the format-only changes the highlighter
+// makes, which textRevision() and textChanged() report.
+class DirtyTracker : public QObject {
+    Q_OBJECT
+
+public:
+    // The document state a save was taken from, so edits made while a
+    // background save is running still count as unsaved afterwards
+    struct SavePoint {
+        QVector<size_t> hashes;
+        int textRevision;
+    };
+
+    explicit DirtyTracker(QTextDocument* document, QObject* parent = nullptr);
+
+    SavePoint savePoint() const;
+    void markSaved();
+    void markSaved(const SavePoint& point);
+    bool isDirty() const { return dirty; }
+
+    // Bumped by every change to the text, and by nothing else. Unlike
+    // QTextDocument::revision it counts with the document's undo disabled.
+    int textRevision() const { return revision; }
+
+signals:
+    void dirtyChanged(bool dirty);
+    void textChanged();
+
+private slots:
+    void handleContentsChange(int position, int charsRemoved, int charsAdded);
+    void updateDirty();
+
+private:
+    void rebuildHashes();
+    void recountMismatches();
+    bool matchesSavedHashes();
+    void bumpRevision();
+
+    QTextDocument* document;
+    QVector<size_t> currentHashes;  // One entry per block, kept in sync on every change
+    QVector<size_t> savedHashes;    // Snapshot of currentHashes taken by markSaved()
+    int mismatches;                 // Blocks differing from savedHashes at the same index
+    bool mismatchesValid;           // False after block count shifts until recounted
+    int revision;                   // See textRevision()
+    bool dirty;
+};
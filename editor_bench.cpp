@@ -0,0 +1,435 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QScrollBar>
+#include <QTemporaryDir>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include "editor_window.h"
+#include "code_highlighter.h"
+#include "code_lexer.h"
+#include "text_search.h"
+#include "undo_history.h"
+#include "bulk_inserter.h"
+
+// Headless benchmarks for the editor's hot paths, run over synthetic C++
+// and Python corpora of increasing size. Results go out as JSON so runs
+// from different versions can be compared.
+class EditorBench {
+public:
+    EditorBench(int maxLines, int repeat);
+    QJsonObject run();
+
+private:
+    void benchLexer(CodeLexer::Language language, const QStringList& lines);
+    void benchHighlighter(CodeHighlighter::Language language, const QString& text, int lines);
+    void benchSearch(const QString& text, const QString& language, int lines);
+    void benchStartup();
+    void benchEditor(const QString& filePath, const QString& language, int lines);
+    void benchThemeSwitch(EditorWindow& window, const QString& language, int lines);
+    void benchGutter(EditorWindow& window, const QString& language, int lines);
+    void benchKeystrokes(EditorWindow& window, const QString& language, int lines);
+    void benchIndent(EditorWindow& window, const QString& language, int lines);
+    void benchPaste(EditorWindow& window, const QString& language, int lines);
+
+    void record(const QString& name, const QString& language, int lines, double value, const QString& unit);
+    static QStringList makeCorpus(CodeLexer::Language language, int lines);
+    static bool waitUntil(const std::function<bool()>& done, int timeoutMs = 600000);
+
+    QList<int> sizes;
+    int repeat;
+    QTemporaryDir dir;
+    QJsonArray results;
+};
+
+namespace {
+const QLatin1String cppTemplate[] = {
+    QLatin1String("#include <vector>"),
+    QLatin1String("// Line comment number %1"),
+    QLatin1String("/* Block comment that"),
+    QLatin1String("   continues on the next line */"),
+    QLatin1String("static int value%1 = %1 + 0x2A;"),
+    QLatin1String("class Widget%1 : public Base {"),
+    QLatin1String("public:"),
+    QLatin1String("    void update(int count) { total += count * 3.5; }"),
+    QLatin1String("    const char* name = \"widget \\\"%1\\\"\";"),
+    QLatin1String("};"),
+    QLatin1String("auto raw%1 = R\"(raw string %1)\";"),
+    QLatin1String("")
+};
+
+const QLatin1String pythonTemplate[] = {
+    QLatin1String("import os"),
+    QLatin1String("# Comment number %1"),
+    QLatin1String("@decorator"),
+    QLatin1String("def function_%1(value):"),
+    QLatin1String("    \"\"\"Docstring that"),
+    QLatin1String("    spans two lines\"\"\""),
+    QLatin1String("    return value * %1 + 0.5"),
+    QLatin1String("class Thing%1(object):"),
+    QLatin1String("    name = 'thing %1'"),
+    QLatin1String("")
+};
+
+const int gutterFrames = 200;
+const int themeSwitches = 20;
+const int keystrokes = 200;
+
+double megabytes(const QString& text) {
+    return text.toUtf8().size() / (1024.0 * 1024.0);
+}
+}
+
+EditorBench::EditorBench(int maxLines, int repeat)
+    : repeat(qMax(1, repeat))
+{
+    for (int lines : {1000, 10000, 100000, 1000000}) {
+        if (lines <= maxLines) {
+            sizes.append(lines);
+        }
+    }
+}
+
+QStringList EditorBench::makeCorpus(CodeLexer::Language language, int lines) {
+    const QLatin1String* begin = language == CodeLexer::CPP ? std::begin(cppTemplate) : std::begin(pythonTemplate);
+    const QLatin1String* end = language == CodeLexer::CPP ? std::end(cppTemplate) : std::end(pythonTemplate);
+    const int count = end - begin;
+
+    QStringList corpus;
+    corpus.reserve(lines);
+    for (int i = 0; i < lines; ++i) {
+        QString line = begin[i % count];
+        corpus.append(line.replace(QLatin1String("%1"), QString::number(i)));
+    }
+    return corpus;
+}
+
+bool EditorBench::waitUntil(const std::function<bool()>& done, int timeoutMs) {
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.hasExpired(timeoutMs)) return false;
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    return true;
+}
+
+void EditorBench::record(const QString& name, const QString& language, int lines, double value, const QString& unit) {
+    results.append(QJsonObject{
+        {QStringLiteral("name"), name},
+        {QStringLiteral("language"), language},
+        {QStringLiteral("lines"), lines},
+        {QStringLiteral("value"), value},
+        {QStringLiteral("unit"), unit}
+    });
+}
+
+QJsonObject EditorBench::run() {
+    const struct {
+        CodeLexer::Language lexer;
+        CodeHighlighter::Language highlighter;
+        QString name;
+        QString suffix;
+    } languages[] = {
+        {CodeLexer::CPP, CodeHighlighter::CPP, QStringLiteral("cpp"), QStringLiteral("cpp")},
+        {CodeLexer::Python, CodeHighlighter::Python, QStringLiteral("python"), QStringLiteral("py")}
+    };
+
+    benchStartup();
+    
+    for (const auto& language : languages) {
+        for (int lines : std::as_const(sizes)) {
+            const QStringList corpus = makeCorpus(language.lexer, lines);
+            const QString text = corpus.join(QLatin1Char('\n'));
+
+            benchLexer(language.lexer, corpus);
+            benchHighlighter(language.highlighter, text, lines);
+            benchSearch(text, language.name, lines);
+
+            const QString filePath = dir.filePath(QStringLiteral("corpus_%1.%2").arg(lines).arg(language.suffix));
+            QFile file(filePath);
+            if (!file.open(QIODevice::WriteOnly) || file.write(text.toUtf8()) < 0) {
+                qWarning("Cannot write corpus %s", qPrintable(filePath));
+                continue;
+            }
+            file.close();
+            benchEditor(filePath, language.name, lines);
+        }
+    }
+
+    return QJsonObject{
+        {QStringLiteral("version"), QString::fromLatin1(FOCUSED_EDITOR_VERSION)},
+        {QStringLiteral("qt"), QString::fromLatin1(qVersion())},
+        {QStringLiteral("results"), results}
+    };
+}
+
+void EditorBench::benchLexer(CodeLexer::Language language, const QStringList& lines) {
+    // Raw lexer throughput, the work highlightBlock does per line
+    qint64 bytes = 0;
+    for (const QString& line : lines) {
+        bytes += line.toUtf8().size() + 1;
+    }
+
+    qint64 best = std::numeric_limits<qint64>::max();
+    QVector<CodeLexer::Token> tokens;
+    for (int run = 0; run < repeat; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        int state = CodeLexer::NormalState;
+        for (const QString& line : lines) {
+            tokens.clear();
+            state = CodeLexer::lexLine(language, line, state, tokens);
+        }
+        best = qMin(best, timer.nsecsElapsed());
+    }
+
+    const QString name = language == CodeLexer::CPP ? QStringLiteral("cpp") : QStringLiteral("python");
+    record(QStringLiteral("lexer_throughput"), name, lines.size(),
+           bytes / (1024.0 * 1024.0) / (qMax<qint64>(best, 1) / 1e9), QStringLiteral("MB/s"));
+}
+
+void EditorBench::benchHighlighter(CodeHighlighter::Language language, const QString& text, int lines) {
+    // A full lazy pass through highlightBlock, worker included, until the
+    // last block has its formats
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int run = 0; run < repeat; ++run) {
+        QTextDocument document;
+        document.setPlainText(text);
+        CodeHighlighter highlighter(&document);
+        QCoreApplication::processEvents();
+
+        QElapsedTimer timer;
+        timer.start();
+        highlighter.setLanguage(language);
+        if (!waitUntil([&highlighter] { return !highlighter.isHighlighting(); })) {
+            qWarning("Highlighting %d lines timed out", lines);
+            return;
+        }
+        best = qMin(best, timer.nsecsElapsed());
+    }
+
+    const QString name = language == CodeHighlighter::CPP ? QStringLiteral("cpp") : QStringLiteral("python");
+    record(QStringLiteral("highlight_throughput"), name, lines,
+           megabytes(text) / (qMax<qint64>(best, 1) / 1e9), QStringLiteral("MB/s"));
+}
+
+void EditorBench::benchSearch(const QString& text, const QString& language, int lines) {
+    // A needle that never matches, so every kernel scans the whole text
+    const QString needle = QStringLiteral("needle_that_is_not_there");
+    for (int kernel = TextSearch::Scalar; kernel <= TextSearch::bestKernel(); ++kernel) {
+        qint64 best = std::numeric_limits<qint64>::max();
+        for (int run = 0; run < repeat; ++run) {
+            QElapsedTimer timer;
+            timer.start();
+            TextSearch::findAll(TextSearch::Kernel(kernel), text, needle, Qt::CaseInsensitive, nullptr, 0);
+            best = qMin(best, timer.nsecsElapsed());
+        }
+        record(QStringLiteral("find_throughput_%1").arg(QLatin1String(TextSearch::kernelName(TextSearch::Kernel(kernel)))),
+               language, lines, megabytes(text) / (qMax<qint64>(best, 1) / 1e9), QStringLiteral("MB/s"));
+    }
+}
+
+void EditorBench::benchStartup() {
+    // Window construction up to its first shown frame
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int run = 0; run < repeat; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        EditorWindow window;
+        window.resize(1024, 768);
+        window.show();
+        QCoreApplication::processEvents();
+        best = qMin(best, timer.nsecsElapsed());
+    }
+    record(QStringLiteral("startup"), QString(), 0, best / 1e6, QStringLiteral("ms"));
+}
+
+void EditorBench::benchEditor(const QString& filePath, const QString& language, int lines) {
+    EditorWindow window;
+    window.resize(1024, 768);
+    window.show();
+    QCoreApplication::processEvents();
+
+    // Load until the document is complete, then until it is fully highlighted
+    QElapsedTimer timer;
+    timer.start();
+    window.loadFile(filePath);
+    if (!waitUntil([&window] { return !window.isLoading(); })) {
+        qWarning("Loading %s timed out", qPrintable(filePath));
+        return;
+    }
+    record(QStringLiteral("load"), language, lines, timer.nsecsElapsed() / 1e6, QStringLiteral("ms"));
+    waitUntil([&window] { return !window.isHighlighting(); });
+    record(QStringLiteral("load_highlighted"), language, lines, timer.nsecsElapsed() / 1e6, QStringLiteral("ms"));
+
+    // Save to a second file, including the background write
+    const QString savePath = filePath + QStringLiteral(".saved");
+    timer.restart();
+    window.saveAndWait(savePath);
+    QCoreApplication::processEvents();
+    record(QStringLiteral("save"), language, lines, timer.nsecsElapsed() / 1e6, QStringLiteral("ms"));
+
+    benchGutter(window, language, lines);
+    benchThemeSwitch(window, language, lines);
+    benchKeystrokes(window, language, lines);
+    benchIndent(window, language, lines);
+    benchPaste(window, language, lines);
+}
+
+void EditorBench::benchGutter(EditorWindow& window, const QString& language, int lines) {
+    // Paint the gutter scrolled to the middle of the document
+    QScrollBar* scrollBar = window.textEditor()->verticalScrollBar();
+    scrollBar->setValue(scrollBar->maximum() / 2);
+    QCoreApplication::processEvents();
+
+    LineNumberArea* gutter = window.lineNumbers();
+    QImage image(gutter->size().expandedTo(QSize(1, 1)), QImage::Format_ARGB32_Premultiplied);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < gutterFrames; ++frame) {
+        gutter->render(&image);
+    }
+    record(QStringLiteral("gutter_paint"), language, lines,
+           timer.nsecsElapsed() / 1e3 / gutterFrames, QStringLiteral("us/frame"));
+}
+
+void EditorBench::benchThemeSwitch(EditorWindow& window, const QString& language, int lines) {
+    // Reapplying the theme with a loaded, highlighted document, including
+    // the repaint it causes
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < themeSwitches; ++i) {
+        window.updateTheme();
+        window.textEditor()->viewport()->repaint();
+    }
+    record(QStringLiteral("theme_switch"), language, lines,
+           timer.nsecsElapsed() / 1e6 / themeSwitches, QStringLiteral("ms"));
+}
+
+void EditorBench::benchKeystrokes(EditorWindow& window, const QString& language, int lines) {
+    // Type into the middle of the document through the same event filters
+    // as real input, repainting the viewport after each key
+    CustomEditor* editor = window.textEditor();
+    QTextCursor cursor(editor->document()->findBlockByNumber(lines / 2));
+    cursor.movePosition(QTextCursor::EndOfBlock);
+    editor->setTextCursor(cursor);
+    editor->setFocus();
+
+    const QString typed = QStringLiteral("value = other + 1;\n");
+    QVector<qint64> samples;
+    samples.reserve(keystrokes);
+    for (int i = 0; i < keystrokes; ++i) {
+        const QChar ch = typed[i % typed.size()];
+        const int key = ch == QLatin1Char('\n') ? Qt::Key_Return : ch.toUpper().unicode();
+        const QString text = ch == QLatin1Char('\n') ? QStringLiteral("\r") : QString(ch);
+
+        QElapsedTimer timer;
+        timer.start();
+        QKeyEvent press(QEvent::KeyPress, key, Qt::NoModifier, text);
+        QKeyEvent release(QEvent::KeyRelease, key, Qt::NoModifier, text);
+        QApplication::sendEvent(editor, &press);
+        QApplication::sendEvent(editor, &release);
+        editor->viewport()->repaint();
+        samples.append(timer.nsecsElapsed());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    record(QStringLiteral("keystroke_p50"), language, lines, samples[samples.size() / 2] / 1e3, QStringLiteral("us"));
+    record(QStringLiteral("keystroke_p99"), language, lines, samples[samples.size() * 99 / 100] / 1e3, QStringLiteral("us"));
+    record(QStringLiteral("undo_memory"), language, lines, editor->undoHistory()->memoryUsage() / 1024.0, QStringLiteral("KB"));
+
+    // Don't leave anything behind that would prompt on close
+    editor->document()->setModified(false);
+}
+
+void EditorBench::benchIndent(EditorWindow& window, const QString& language, int lines) {
+    // Indent and outdent the whole document with Tab and Shift+Tab
+    CustomEditor* editor = window.textEditor();
+    editor->selectAll();
+    editor->setFocus();
+
+    const int keys[] = {Qt::Key_Tab, Qt::Key_Backtab};
+    const char* names[] = {"indent_all", "outdent_all"};
+    for (int i = 0; i < 2; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        QKeyEvent press(QEvent::KeyPress, keys[i], i == 0 ? Qt::NoModifier : Qt::ShiftModifier);
+        QApplication::sendEvent(editor, &press);
+        editor->viewport()->repaint();
+        record(QLatin1String(names[i]), language, lines, timer.nsecsElapsed() / 1e6, QStringLiteral("ms"));
+    }
+
+    editor->document()->setModified(false);
+}
+
+void EditorBench::benchPaste(EditorWindow& window, const QString& language, int lines) {
+    // Paste the whole document again at its end, through the same bulk
+    // path as a large clipboard paste, until it is in and announced
+    CustomEditor* editor = window.textEditor();
+    const QString text = editor->toPlainText();
+    QTextCursor cursor(editor->document());
+    cursor.movePosition(QTextCursor::End);
+
+    QElapsedTimer timer;
+    timer.start();
+    editor->bulkInserter()->start(cursor, text);
+    if (!waitUntil([editor] { return !editor->bulkInserter()->isRunning(); })) {
+        qWarning("Pasting timed out");
+        return;
+    }
+    record(QStringLiteral("paste"), language, lines, timer.nsecsElapsed() / 1e6, QStringLiteral("ms"));
+
+    editor->document()->setModified(false);
+}
+
+int main(int argc, char* argv[]) {
+    // Headless unless a platform was asked for explicitly
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("focused_editor_bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Benchmarks the editor's load, save, highlight, paint and typing paths."));
+    parser.addHelpOption();
+    QCommandLineOption maxLinesOption(QStringLiteral("max-lines"),
+                                      QStringLiteral("Largest corpus to generate (1000 to 1000000)."),
+                                      QStringLiteral("lines"), QStringLiteral("1000000"));
+    QCommandLineOption repeatOption(QStringLiteral("repeat"),
+                                    QStringLiteral("Runs per throughput measurement; the best is reported."),
+                                    QStringLiteral("count"), QStringLiteral("3"));
+    QCommandLineOption outputOption({QStringLiteral("o"), QStringLiteral("output")},
+                                    QStringLiteral("Write the JSON results to a file instead of stdout."),
+                                    QStringLiteral("file"));
+    parser.addOptions({maxLinesOption, repeatOption, outputOption});
+    parser.process(app);
+
+    EditorBench bench(parser.value(maxLinesOption).toInt(), parser.value(repeatOption).toInt());
+    const QByteArray json = QJsonDocument(bench.run()).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            qCritical("Cannot write %s", qPrintable(parser.value(outputOption)));
+            return 1;
+        }
+    } else {
+        QFile out;
+        out.open(stdout, QIODevice::WriteOnly);
+        out.write(json);
+    }
+    return 0;
+}
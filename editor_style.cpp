@@ -0,0 +1,81 @@
+#include "editor_style.h"
+#include <QPainter>
+#include <QStyleOptionSlider>
+
+EditorStyle::EditorStyle(QStyle* baseStyle)
+    : QProxyStyle(baseStyle)
+{
+}
+
+int EditorStyle::pixelMetric(PixelMetric metric, const QStyleOption* option, const QWidget* widget) const {
+    switch (metric) {
+        case PM_ScrollBarExtent:
+            return scrollBarExtent;
+        case PM_ScrollBarSliderMin:
+            return minSliderLength;
+        default:
+            return QProxyStyle::pixelMetric(metric, option, widget);
+    }
+}
+
+QRect EditorStyle::subControlRect(ComplexControl control, const QStyleOptionComplex* option,
+                                  SubControl subControl, const QWidget* widget) const {
+    const QStyleOptionSlider* bar = qstyleoption_cast<const QStyleOptionSlider*>(option);
+    if (control != CC_ScrollBar || !bar) {
+        return QProxyStyle::subControlRect(control, option, subControl, widget);
+    }
+    
+    // The whole bar is groove; there are no line buttons
+    const QRect rect = bar->rect;
+    const bool horizontal = bar->orientation == Qt::Horizontal;
+    const int length = horizontal ? rect.width() : rect.height();
+    const qint64 range = qint64(bar->maximum) - bar->minimum;
+    
+    int sliderLength = length;
+    if (range > 0) {
+        sliderLength = int(qint64(length) * bar->pageStep / (range + bar->pageStep));
+        sliderLength = qBound(qMin(minSliderLength, length), sliderLength, length);
+    }
+    const int sliderStart = sliderPositionFromValue(bar->minimum, bar->maximum, bar->sliderPosition,
+                                                    length - sliderLength, bar->upsideDown);
+    const int sliderEnd = sliderStart + sliderLength;
+    
+    auto span = [&](int from, int to) {
+        return horizontal ? QRect(rect.x() + from, rect.y(), to - from, rect.height())
+                          : QRect(rect.x(), rect.y() + from, rect.width(), to - from);
+    };
+    
+    switch (subControl) {
+        case SC_ScrollBarGroove:
+            return rect;
+        case SC_ScrollBarSlider:
+            return span(sliderStart, sliderEnd);
+        case SC_ScrollBarSubPage:
+            return span(0, sliderStart);
+        case SC_ScrollBarAddPage:
+            return span(sliderEnd, length);
+        default:
+            return QRect();
+    }
+}
+
+void EditorStyle::drawComplexControl(ComplexControl control, const QStyleOptionComplex* option,
+                                     QPainter* painter, const QWidget* widget) const {
+    if (control != CC_ScrollBar) {
+        QProxyStyle::drawComplexControl(control, option, painter, widget);
+        return;
+    }
+    
+    painter->fillRect(option->rect, option->palette.color(QPalette::Window));
+    
+    const QRect slider = subControlRect(control, option, SC_ScrollBarSlider, widget);
+    if (slider.isEmpty()) return;
+    
+    const qreal radius = qMin(slider.width(), slider.height()) / 2.0;
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(option->palette.color(QPalette::Mid));
+    painter->drawRoundedRect(slider, radius, radius);
+    painter->restore();
+}
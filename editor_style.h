@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QProxyStyle>
+
+// Proxy style for the editor's scroll bars: thin bars without arrow
+// buttons and a rounded handle. The track is drawn in the palette's
+// Window color and the handle in Mid, so a theme change is a palette
+// change and nothing has to be re-polished from a stylesheet.
+class EditorStyle : public QProxyStyle {
+    Q_OBJECT
+
+public:
+    explicit EditorStyle(QStyle* baseStyle = nullptr);
+
+    int pixelMetric(PixelMetric metric, const QStyleOption* option = nullptr,
+                    const QWidget* widget = nullptr) const override;
+    QRect subControlRect(ComplexControl control, const QStyleOptionComplex* option,
+                         SubControl subControl, const QWidget* widget = nullptr) const override;
+    void drawComplexControl(ComplexControl control, const QStyleOptionComplex* option,
+                            QPainter* painter, const QWidget* widget = nullptr) const override;
+
+private:
+    const int scrollBarExtent = 8;
+    const int minSliderLength = 24;
+};
@@ -7,7 +7,7 @@
 #include <QKeySequence>
 #include <QFileDialog>
 #include <QMessageBox>
-#include <QTextStream>
+#include <QFile>
 #include <QFileInfo>
 #include <QCloseEvent>
 #include <QPalette>
@@ -15,17 +15,60 @@
 #include <QApplication>
 #include <QTextBlock>
 #include <QScrollBar>
-#include <QSettings>
+#include <QProgressBar>
+#include <QFileSystemWatcher>
 #include "code_highlighter.h"
 #include "indent_manager.h"
 #include "line_number_area.h"
 #include "custom_editor.h"
+#include "undo_history.h"
+#include "bulk_inserter.h"
+#include "dirty_tracker.h"
+#include "file_loader.h"
+#include "file_saver.h"
+#include "file_reloader.h"
+#include "large_file_view.h"
+#include "latency_monitor.h"
+#include "latency_overlay.h"
+#include "editor_style.h"
+#include "splash_view.h"
+#include "startup_profile.h"
+#include "settings_store.h"
+#include "zoom_preview.h"
+#include "find_bar.h"
+#include "text_finder.h"
+#include "text_replacer.h"
+#include "project_search_panel.h"
+#include <QDir>
+#include <QTimer>
+#include <algorithm>
 
 EditorWindow::EditorWindow(QWidget* parent)
     : QMainWindow(parent)
     , unsavedChanges(false)
     , currentZoom(13)  // Reset to default 13pt
     , showingSplash(false)
+    , loading(false)
+    , largeFileMode(false)
+    , editorReady(false)
+    , highlighter(nullptr)
+    , indentManager(nullptr)
+    , lineNumberArea(nullptr)
+    , largeFileView(nullptr)
+    , latencyOverlay(nullptr)
+    , editorStyle(nullptr)
+    , zoomPreview(nullptr)
+    , zoomCommitTimer(nullptr)
+    , findBar(nullptr)
+    , textFinder(nullptr)
+    , researchTimer(nullptr)
+    , searchSnapshotStale(true)
+    , matchCount(0)
+    , moveToMatch(false)
+    , projectSearchPanel(nullptr)
+    , pendingLine(-1)
+    , reloadRevision(0)
+    , diskSize(-1)
 {
     setMinimumSize(400, 300);
     
@@ -37,42 +80,78 @@ EditorWindow::EditorWindow(QWidget* parent)
     layout->setContentsMargins(0, 0, 0, 0);
     layout->setSpacing(0);
     
-    // Create and configure editor
+    // Create and configure editor. It stays hidden behind the splash until
+    // first use; ensureEditorReady() builds everything that serves it.
     editor = new CustomEditor(this);
     editor->setFrameStyle(0);  // Remove frame
+    editor->document()->setDocumentMargin(20);
+    editor->hide();
     
-    // Create syntax highlighter and indent manager
-    highlighter = new CodeHighlighter(editor->document());
-    indentManager = new IndentManager(editor, this);
+    // Painted welcome screen, cheap enough to be the first frame
+    splash = new SplashView(central);
+    splash->installEventFilter(this);
     
-    // Create line number area (initially hidden)
-    lineNumberArea = new LineNumberArea(editor);
-    lineNumberArea->setVisible(false);
+    // Track unsaved changes against the last saved state
+    dirtyTracker = new DirtyTracker(editor->document(), this);
     
-    // Install event filters
-    editor->viewport()->installEventFilter(this);
-    editor->installEventFilter(this);
+    // Add splash and editor to layout
+    layout->addWidget(splash);
+    layout->addWidget(editor);
     
-    // Initial theme setup (this will also set the font from settings)
-    updateTheme();
+    // Thin progress bar shown only while a file streams in
+    loadProgress = new QProgressBar(central);
+    loadProgress->setRange(0, 100);
+    loadProgress->setTextVisible(false);
+    loadProgress->setFixedHeight(3);
+    loadProgress->hide();
+    layout->addWidget(loadProgress);
     
-    // Add editor to layout
-    layout->addWidget(editor);
+    // Background file loading
+    fileLoader = new FileLoader(this);
+    connect(fileLoader, &FileLoader::chunkReady, this, &EditorWindow::appendLoadedChunk);
+    connect(fileLoader, &FileLoader::progress, loadProgress, &QProgressBar::setValue);
+    connect(fileLoader, &FileLoader::finished, this, &EditorWindow::finishLoading);
+    connect(fileLoader, &FileLoader::failed, this, &EditorWindow::handleLoadFailed);
+    
+    // Background file saving
+    fileSaver = new FileSaver(this);
+    connect(fileSaver, &FileSaver::finished, this, &EditorWindow::handleSaveFinished);
+    connect(fileSaver, &FileSaver::failed, this, &EditorWindow::handleSaveFailed);
+    connect(fileSaver, &FileSaver::snapshotStarted, this, [this] {
+        editor->setReadOnly(true);
+    });
+    connect(fileSaver, &FileSaver::snapshotFinished, this, [this] {
+        editor->setReadOnly(false);
+    });
+    
+    // Pick up changes other programs make to the open file
+    fileWatcher = new QFileSystemWatcher(this);
+    reloadTimer = new QTimer(this);
+    reloadTimer->setSingleShot(true);
+    reloadTimer->setInterval(reloadDelayMs);
+    connect(fileWatcher, &QFileSystemWatcher::fileChanged, reloadTimer, qOverload<>(&QTimer::start));
+    connect(reloadTimer, &QTimer::timeout, this, &EditorWindow::checkDiskChanges);
+    fileReloader = new FileReloader(this);
+    connect(fileReloader, &FileReloader::finished, this, &EditorWindow::applyReload);
+    connect(fileReloader, &FileReloader::failed, this, &EditorWindow::handleReloadFailed);
+    indentDetector = new IndentDetector(this);
+    connect(indentDetector, &IndentDetector::detected, this, &EditorWindow::handleIndentDetected);
     
     // Initialize UI elements
     initUI();
     setupShortcuts();
     
-    // Show splash screen
+    // Show splash screen; until the editor is needed the theme only colors it
     showSplashScreen();
+    updateTheme();
     
     // Connect to system theme changes
     connect(qApp->styleHints(), &QStyleHints::colorSchemeChanged,
             this, &EditorWindow::updateTheme);
             
     // Connect editor signals
-    connect(editor->document(), &QTextDocument::contentsChange,
-            this, &EditorWindow::handleTextChanged);
+    connect(dirtyTracker, &DirtyTracker::dirtyChanged,
+            this, &EditorWindow::handleDirtyChanged);
             
     connect(editor, &QPlainTextEdit::updateRequest,
             this, &EditorWindow::updateLineNumberArea);
@@ -81,6 +160,73 @@ EditorWindow::EditorWindow(QWidget* parent)
             this, &EditorWindow::updateLineNumberAreaWidth);
 }
 
+void EditorWindow::ensureEditorReady() {
+    if (editorReady) return;
+    editorReady = true;
+    
+    // Virtualized view that takes over for files too large for the editor
+    QVBoxLayout* layout = static_cast<QVBoxLayout*>(centralWidget()->layout());
+    largeFileView = new LargeFileView(centralWidget());
+    largeFileView->hide();
+    layout->insertWidget(layout->indexOf(editor) + 1, largeFileView);
+    connect(largeFileView, &LargeFileView::modificationChanged,
+            this, &EditorWindow::handleLargeFileModified);
+    
+    // Thin scroll bars for both views
+    editorStyle = new EditorStyle();
+    editorStyle->setParent(this);
+    for (QAbstractScrollArea* area : {static_cast<QAbstractScrollArea*>(editor),
+                                      static_cast<QAbstractScrollArea*>(largeFileView)}) {
+        area->verticalScrollBar()->setStyle(editorStyle);
+        area->horizontalScrollBar()->setStyle(editorStyle);
+    }
+    
+    // Create syntax highlighter and indent manager
+    highlighter = new CodeHighlighter(editor->document());
+    highlighter->setEditor(editor);
+    indentManager = new IndentManager(editor, this);
+    connect(indentManager, &IndentManager::largeEditStarting,
+            highlighter, &CodeHighlighter::rehighlightFrom);
+    
+    // Large pastes hold the highlighter's pass until they are complete and
+    // show their progress like a file being loaded
+    BulkInserter* inserter = editor->bulkInserter();
+    connect(inserter, &BulkInserter::started, this, [this](int position) {
+        highlighter->suspend(position);
+        loadProgress->setValue(0);
+        loadProgress->show();
+    });
+    connect(inserter, &BulkInserter::progress, loadProgress, &QProgressBar::setValue);
+    connect(inserter, &BulkInserter::finished, this, [this] {
+        loadProgress->hide();
+        highlighter->resume();
+    });
+    
+    // Create line number area (initially hidden)
+    lineNumberArea = new LineNumberArea(editor);
+    lineNumberArea->setVisible(false);
+    
+    // Zoom steps are previewed as a scaled snapshot and committed once they stop
+    zoomPreview = new ZoomPreview(editor->viewport());
+    zoomCommitTimer = new QTimer(this);
+    zoomCommitTimer->setSingleShot(true);
+    zoomCommitTimer->setInterval(zoomCommitDelayMs);
+    connect(zoomCommitTimer, &QTimer::timeout, this, &EditorWindow::commitZoom);
+    
+    // Installed after IndentManager's so this filter still sees keys first
+    editor->viewport()->installEventFilter(this);
+    editor->installEventFilter(this);
+    
+    // Font and undo budget from settings, palettes and highlighter
+    // colors; later changes to the settings are applied one key at a time
+    applyFont();
+    editor->undoHistory()->setBudget(SettingsStore::instance().undoBudgetMB() * 1024 * 1024);
+    connect(&SettingsStore::instance(), &SettingsStore::valueChanged,
+            this, &EditorWindow::handleSettingChanged);
+    updateTheme();
+    StartupProfile::mark("editor ready");
+}
+
 void EditorWindow::setupShortcuts() {
     // File operations
     QAction* saveAction = new QAction(this);
@@ -101,10 +247,36 @@ void EditorWindow::setupShortcuts() {
     
     // View operations
     QAction* fullscreenAction = new QAction(this);
-    fullscreenAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_F));
+    fullscreenAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_F));
     connect(fullscreenAction, &QAction::triggered, this, &EditorWindow::toggleFullscreen);
     addAction(fullscreenAction);
     
+    // Find
+    QAction* findAction = new QAction(this);
+    findAction->setShortcut(QKeySequence::Find);
+    connect(findAction, &QAction::triggered, this, &EditorWindow::showFindBar);
+    addAction(findAction);
+    
+    QAction* replaceAction = new QAction(this);
+    replaceAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_H));
+    connect(replaceAction, &QAction::triggered, this, &EditorWindow::showReplaceBar);
+    addAction(replaceAction);
+    
+    QAction* findNextAction = new QAction(this);
+    findNextAction->setShortcut(QKeySequence::FindNext);
+    connect(findNextAction, &QAction::triggered, this, &EditorWindow::findNext);
+    addAction(findNextAction);
+    
+    QAction* findPreviousAction = new QAction(this);
+    findPreviousAction->setShortcut(QKeySequence::FindPrevious);
+    connect(findPreviousAction, &QAction::triggered, this, &EditorWindow::findPrevious);
+    addAction(findPreviousAction);
+    
+    QAction* projectSearchAction = new QAction(this);
+    projectSearchAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_P));
+    connect(projectSearchAction, &QAction::triggered, this, &EditorWindow::showProjectSearch);
+    addAction(projectSearchAction);
+    
     // Zoom in with Cmd + =
     QAction* zoomInAction = new QAction(this);
     zoomInAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_Equal));
@@ -133,6 +305,43 @@ void EditorWindow::setupShortcuts() {
     lineNumbersAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_L));
     connect(lineNumbersAction, &QAction::triggered, this, &EditorWindow::toggleLineNumbers);
     addAction(lineNumbersAction);
+    
+    // Latency overlay and trace export
+    QAction* latencyOverlayAction = new QAction(this);
+    latencyOverlayAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_L));
+    connect(latencyOverlayAction, &QAction::triggered, this, &EditorWindow::toggleLatencyOverlay);
+    addAction(latencyOverlayAction);
+    
+    QAction* exportTraceAction = new QAction(this);
+    exportTraceAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_T));
+    connect(exportTraceAction, &QAction::triggered, this, &EditorWindow::exportLatencyTrace);
+    addAction(exportTraceAction);
+}
+
+void EditorWindow::toggleLatencyOverlay() {
+    // Built on first use; most sessions never open it
+    if (!latencyOverlay) {
+        latencyOverlay = new LatencyOverlay(centralWidget());
+        latencyOverlay->setUndoHistory(editor->undoHistory());
+    }
+    latencyOverlay->toggle();
+}
+
+void EditorWindow::exportLatencyTrace() {
+    QString filePath = QFileDialog::getSaveFileName(
+        this,
+        tr("Export Latency Trace"),
+        QStringLiteral("latency_trace.json"),
+        tr("Trace Files (*.json)")
+    );
+    if (filePath.isEmpty()) return;
+    
+    // Chrome trace event JSON; opens in chrome://tracing or Perfetto
+    QFile file(filePath);
+    const QByteArray trace = LatencyMonitor::instance().chromeTrace();
+    if (!file.open(QIODevice::WriteOnly) || file.write(trace) != trace.size()) {
+        QMessageBox::warning(this, tr("Error"), tr("Cannot write trace: ") + file.errorString());
+    }
 }
 
 void EditorWindow::toggleLineNumbers() {
@@ -154,95 +363,341 @@ void EditorWindow::updateTheme() {
     QString scrollbarBg = isDarkMode ? "#2D2D2D" : "#F0F0F0";
     QString scrollbarHandle = isDarkMode ? "#4A4A4A" : "#CCCCCC";
     
-    // Load saved font settings
-    QSettings settings("Focused Editor", "Editor");
-    QString fontFamily = settings.value("font/family", "Menlo").toString();
-    int fontSize = settings.value("font/size", 13).toInt();  // Changed default to 13pt
+    QPalette splashPalette = splash->palette();
+    splashPalette.setColor(QPalette::Base, QColor(backgroundColor));
+    splashPalette.setColor(QPalette::Text, QColor(textColor));
+    splash->setPalette(splashPalette);
     
-    QFont font(fontFamily, fontSize);
+    // The editor's palettes and the highlighter wait until it is in use
+    if (!editorReady) return;
+    
+    // Colors go through palettes only; the scroll bars are drawn by
+    // EditorStyle from the same palette, so nothing is re-polished
+    QPalette palette = editor->palette();
+    palette.setColor(QPalette::Base, QColor(backgroundColor));
+    palette.setColor(QPalette::Text, QColor(textColor));
+    palette.setColor(QPalette::Window, QColor(scrollbarBg));
+    palette.setColor(QPalette::Mid, QColor(scrollbarHandle));
+    editor->setPalette(palette);
+    largeFileView->setPalette(palette);
+    
+    // Update syntax highlighter theme
+    highlighter->updateTheme(isDarkMode);
+    
+    matchColor = QColor(isDarkMode ? "#613214" : "#FFE58F");
+    if (findBar) {
+        findBar->setPalette(panelPalette());
+        updateMatchHighlights();
+    }
+    if (projectSearchPanel) {
+        projectSearchPanel->setPalette(panelPalette());
+    }
+}
+
+QPalette EditorWindow::panelPalette() const {
+    // Panels below the editor sit on the scroll bar color; their inputs
+    // and lists use the editor's
+    QPalette palette = editor->palette();
+    palette.setColor(QPalette::WindowText, palette.color(QPalette::Text));
+    palette.setColor(QPalette::ButtonText, palette.color(QPalette::Text));
+    return palette;
+}
+
+void EditorWindow::applyFont() {
+    const SettingsStore& settings = SettingsStore::instance();
+    QFont font(settings.fontFamily(), settings.fontSize());
     font.setStyleHint(QFont::Monospace);
     font.setFixedPitch(true);
     
-    // Apply font to editor
-    editor->setFont(font);
-    editor->document()->setDefaultFont(font);
-    currentZoom = fontSize;
-    
-    editor->setStyleSheet(QString(R"(
-        QPlainTextEdit {
-            background-color: %1;
-            border: none;
-            color: %2;
-            padding: 20px;
-        }
-        QScrollBar:vertical {
-            width: 8px;
-            background: %3;
-        }
-        QScrollBar::handle:vertical {
-            background: %4;
-            border-radius: 4px;
-        }
-        QScrollBar::add-line:vertical, QScrollBar::sub-line:vertical,
-        QScrollBar::add-page:vertical, QScrollBar::sub-page:vertical {
-            background: none;
-            border: none;
-        }
-        QScrollBar:horizontal {
-            height: 8px;
-            background: %3;
-        }
-        QScrollBar::handle:horizontal {
-            background: %4;
-            border-radius: 4px;
-        }
-        QScrollBar::add-line:horizontal, QScrollBar::sub-line:horizontal,
-        QScrollBar::add-page:horizontal, QScrollBar::sub-page:horizontal {
-            background: none;
-            border: none;
+    editor->setFont(font);  // Also becomes the document's default font
+    largeFileView->setFont(font);
+    currentZoom = font.pointSize();
+}
+
+void EditorWindow::handleSettingChanged(const QString& key, const QVariant& value) {
+    // Only the changed attribute is touched; colors and highlighting stay as they are
+    if (key == SettingsStore::FontFamily) {
+        QFont font = editor->font();
+        font.setFamily(value.toString());
+        editor->setFont(font);
+        largeFileView->setFont(font);
+    } else if (key == SettingsStore::FontSize) {
+        currentZoom = value.toInt();
+        commitZoom();
+    } else if (key == SettingsStore::UndoBudgetMB) {
+        editor->undoHistory()->setBudget(value.toLongLong() * 1024 * 1024);
+    }
+}
+
+void EditorWindow::createFindBar() {
+    findBar = new FindBar(centralWidget());
+    findBar->setPalette(panelPalette());
+    QVBoxLayout* layout = static_cast<QVBoxLayout*>(centralWidget()->layout());
+    layout->insertWidget(layout->indexOf(loadProgress), findBar);
+    connect(findBar, &FindBar::searchChanged, this, &EditorWindow::runSearch);
+    connect(findBar, &FindBar::findNext, this, &EditorWindow::findNext);
+    connect(findBar, &FindBar::findPrevious, this, &EditorWindow::findPrevious);
+    connect(findBar, &FindBar::replaceAll, this, &EditorWindow::replaceAll);
+    connect(findBar, &FindBar::closed, this, &EditorWindow::closeFindBar);
+    
+    textFinder = new TextFinder(this);
+    connect(textFinder, &TextFinder::finished, this, &EditorWindow::handleSearchFinished);
+    
+    // Edits make the snapshot stale; searching again waits for a pause in
+    // typing. Only text changes count, not the highlighter's reformatting.
+    researchTimer = new QTimer(this);
+    researchTimer->setSingleShot(true);
+    researchTimer->setInterval(researchDelayMs);
+    connect(researchTimer, &QTimer::timeout, this, [this] { startSearch(false); });
+    connect(dirtyTracker, &DirtyTracker::textChanged, this, [this] {
+        // Offsets past the edit no longer line up with the text, neither
+        // those shown nor those a running scan of the old snapshot returns
+        searchSnapshotStale = true;
+        textFinder->cancel();
+        if (!findBar->isVisible()) return;
+        
+        if (!matchPositions.isEmpty()) {
+            matchPositions.clear();
+            updateMatchHighlights();
         }
-    )")
-    .arg(backgroundColor)
-    .arg(textColor)
-    .arg(scrollbarBg)
-    .arg(scrollbarHandle));
+        researchTimer->start();
+    });
     
-    // Update line number area style
-    if (lineNumberArea) {
-        lineNumberArea->setStyleSheet(QString(R"(
-            QWidget {
-                background-color: %1;
-                padding-top: 20px;
-            }
-        )").arg(isDarkMode ? "#1E1E1E" : "#F0F0F0"));
+    // Only matches inside the viewport are highlighted
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, &EditorWindow::updateMatchHighlights);
+}
+
+void EditorWindow::showFindBar() {
+    openFindBar(false);
+}
+
+void EditorWindow::showReplaceBar() {
+    openFindBar(true);
+}
+
+void EditorWindow::openFindBar(bool replace) {
+    if (showingSplash || largeFileMode) return;  // Large-file mode has no document to search
+    
+    if (!findBar) {
+        createFindBar();
     }
     
-    // Update the application-wide palette for consistent theming
-    QPalette palette = QApplication::palette();
-    palette.setColor(QPalette::Window, QColor(backgroundColor));
-    palette.setColor(QPalette::WindowText, QColor(textColor));
-    palette.setColor(QPalette::Base, QColor(backgroundColor));
-    palette.setColor(QPalette::Text, QColor(textColor));
-    QApplication::setPalette(palette);
+    // A selection on one line becomes the needle
+    const QString selected = editor->textCursor().selectedText();
+    findBar->activate(selected.contains(QChar::ParagraphSeparator) ? QString() : selected, replace);
+    runSearch();
+}
+
+void EditorWindow::closeFindBar() {
+    researchTimer->stop();
+    textFinder->cancel();
+    findBar->hide();
+    matchPositions.clear();
+    matchLengths.clear();
+    matchCount = 0;
+    searchSnapshot.clear();  // Frees the copy of the document
+    searchSnapshotStale = true;
+    updateMatchHighlights();
+    editor->setFocus();
+}
+
+void EditorWindow::runSearch() {
+    startSearch(true);
+}
+
+void EditorWindow::startSearch(bool moveToMatch) {
+    researchTimer->stop();
+    this->moveToMatch = moveToMatch;
+    const QString needle = findBar->text();
+    if (needle.isEmpty()) {
+        textFinder->cancel();
+        handleSearchFinished({}, {}, 0);
+        return;
+    }
     
-    // Update syntax highlighter theme
-    highlighter->updateTheme(isDarkMode);
+    updateSearchSnapshot();
+    textFinder->start(searchSnapshot, needle, findBar->caseSensitivity(), findBar->isRegex());
+}
+
+void EditorWindow::updateSearchSnapshot() {
+    if (!searchSnapshotStale) return;
+    
+    // One contiguous copy of the document, reused for every keystroke in
+    // the bar until the document changes. Raw text keeps characters like
+    // non-breaking spaces that toPlainText() would rewrite, so text copied
+    // from it back into the document by a replace stays as it was.
+    searchSnapshot = editor->document()->toRawText();
+    searchSnapshot.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    searchSnapshotStale = false;
+}
+
+void EditorWindow::handleSearchFinished(const QVector<qsizetype>& positions, const QVector<qsizetype>& lengths, qsizetype count) {
+    matchPositions = positions;
+    matchLengths = lengths;
+    matchCount = count;
+    
+    // Incremental: move to the first match from where the current selection
+    // starts, unless this search only caught up with an edit
+    const QTextCursor cursor = editor->textCursor();
+    const auto it = std::lower_bound(matchPositions.cbegin(), matchPositions.cend(), cursor.selectionStart());
+    if (it != matchPositions.cend() && moveToMatch) {
+        selectMatch(it - matchPositions.cbegin());
+    } else {
+        findBar->setMatchCount(-1, matchCount);
+    }
+    updateMatchHighlights();
+}
+
+void EditorWindow::findNext() {
+    if (!findBar || !findBar->isVisible() || matchPositions.isEmpty()) return;
+    
+    const auto it = std::upper_bound(matchPositions.cbegin(), matchPositions.cend(), editor->textCursor().selectionStart());
+    selectMatch(it == matchPositions.cend() ? 0 : it - matchPositions.cbegin());  // Wraps around
+}
+
+void EditorWindow::findPrevious() {
+    if (!findBar || !findBar->isVisible() || matchPositions.isEmpty()) return;
+    
+    const auto it = std::lower_bound(matchPositions.cbegin(), matchPositions.cend(), editor->textCursor().selectionStart());
+    selectMatch(it == matchPositions.cbegin() ? matchPositions.size() - 1 : it - matchPositions.cbegin() - 1);
+}
+
+void EditorWindow::selectMatch(qsizetype index) {
+    QTextCursor cursor(editor->document());
+    cursor.setPosition(matchPositions[index]);
+    cursor.setPosition(matchPositions[index] + matchLength(index), QTextCursor::KeepAnchor);
+    editor->setTextCursor(cursor);
+    editor->centerCursor();
+    findBar->setMatchCount(index, matchCount);
+}
+
+void EditorWindow::showProjectSearch() {
+    if (!projectSearchPanel) {
+        ensureEditorReady();  // Its palette comes from the editor
+        projectSearchPanel = new ProjectSearchPanel(centralWidget());
+        projectSearchPanel->setPalette(panelPalette());
+        QVBoxLayout* layout = static_cast<QVBoxLayout*>(centralWidget()->layout());
+        layout->insertWidget(layout->indexOf(loadProgress), projectSearchPanel);
+        connect(projectSearchPanel, &ProjectSearchPanel::resultActivated,
+                this, &EditorWindow::openSearchResult);
+        connect(projectSearchPanel, &ProjectSearchPanel::closed, this, [this] {
+            (largeFileMode ? static_cast<QWidget*>(largeFileView) : editor)->setFocus();
+        });
+    }
+    
+    // The project is the open file's directory, or where the editor was started
+    const QString root = currentFile.isEmpty() ? QDir::currentPath() : QFileInfo(currentFile).absolutePath();
+    const QString selected = editor->textCursor().selectedText();
+    projectSearchPanel->activate(root, selected.contains(QChar::ParagraphSeparator) ? QString() : selected);
+}
+
+void EditorWindow::openSearchResult(const QString& filePath, int line) {
+    if (!loading && !currentFile.isEmpty() && QFileInfo(filePath) == QFileInfo(currentFile)) {
+        goToLine(line);
+        return;
+    }
+    if (!maybeSave()) return;
+    
+    loadFile(filePath);
+    if (loading) {
+        pendingLine = line;  // Applied once the file has streamed in
+    } else if (currentFile == filePath) {
+        goToLine(line);  // Large files open synchronously
+    }
+}
+
+void EditorWindow::goToLine(int line) {
+    if (largeFileMode) {
+        largeFileView->goToLine(line);
+        largeFileView->setFocus();
+        return;
+    }
+    
+    const QTextBlock block = editor->document()->findBlockByNumber(line);
+    if (!block.isValid()) return;
+    editor->setTextCursor(QTextCursor(block));
+    editor->centerCursor();
+    editor->setFocus();
+}
+
+qsizetype EditorWindow::matchLength(qsizetype index) const {
+    return matchLengths.isEmpty() ? findBar->text().size() : matchLengths[index];
+}
+
+void EditorWindow::replaceAll() {
+    if (loading || editor->isReadOnly() || editor->bulkInserter()->isRunning() || findBar->text().isEmpty()) return;
+    
+    // The whole result is computed from the snapshot before the document is touched
+    updateSearchSnapshot();
+    const TextReplacer::Result result = TextReplacer::replaceAll(
+        searchSnapshot, findBar->text(), findBar->replacement(), findBar->caseSensitivity(), findBar->isRegex());
+    if (!result.error.isEmpty()) {
+        findBar->showStatus(result.error);
+        return;
+    }
+    if (result.edits.isEmpty()) {
+        findBar->setMatchCount(-1, 0);
+        return;
+    }
+    
+    // One edit block: one undo step, one contentsChange for the highlighter,
+    // dirty tracker and layout. Highlighting beyond the viewport is left to
+    // a lazy pass from the first edit. Edits go in back to front so the
+    // snapshot offsets of those still to come stay valid.
+    highlighter->rehighlightFrom(result.edits.first().position);
+    const TextReplacer::Edit& last = result.edits.last();
+    editor->undoHistory()->capture(result.edits.first().position, last.position + last.length);
+    QTextCursor cursor(editor->document());
+    cursor.beginEditBlock();
+    for (auto it = result.edits.crbegin(); it != result.edits.crend(); ++it) {
+        cursor.setPosition(it->position);
+        cursor.setPosition(it->position + it->length, QTextCursor::KeepAnchor);
+        cursor.insertText(it->text);
+    }
+    cursor.endEditBlock();
+    
+    // Nothing left to step through; the count would only say so later
+    researchTimer->stop();
+    textFinder->cancel();
+    matchPositions.clear();
+    matchLengths.clear();
+    matchCount = 0;
+    updateMatchHighlights();
+    findBar->showStatus(result.count == 1 ? tr("1 replaced") : tr("%1 replaced").arg(result.count));
+}
+
+void EditorWindow::updateMatchHighlights() {
+    QList<QTextEdit::ExtraSelection> selections;
+    if (findBar && findBar->isVisible() && !matchPositions.isEmpty()) {
+        // Visible range, in document positions
+        const QRect rect = editor->viewport()->rect();
+        const qsizetype first = editor->cursorForPosition(rect.topLeft()).block().position();
+        const QTextBlock lastBlock = editor->cursorForPosition(rect.bottomRight()).block();
+        const qsizetype last = lastBlock.position() + lastBlock.length();
+        
+        // Literal matches all have the needle's length, so one starting
+        // just above the viewport may still reach into it
+        const qsizetype reach = matchLengths.isEmpty() ? findBar->text().size() : 0;
+        QTextCharFormat format;
+        format.setBackground(matchColor);
+        for (auto it = std::lower_bound(matchPositions.cbegin(), matchPositions.cend(), first - reach);
+             it != matchPositions.cend() && *it < last && selections.size() < maxVisibleMatches; ++it) {
+            QTextEdit::ExtraSelection selection;
+            selection.cursor = QTextCursor(editor->document());
+            selection.cursor.setPosition(*it);
+            selection.cursor.setPosition(*it + matchLength(it - matchPositions.cbegin()), QTextCursor::KeepAnchor);
+            selection.format = format;
+            selections.append(selection);
+        }
+    }
+    editor->setExtraSelections(selections);
 }
 
 void EditorWindow::initUI() {
     // Set window properties
     setWindowTitle("Focused Editor");
     resize(800, 600);
-
-    // Connect signals
-    connect(editor->document(), &QTextDocument::contentsChange,
-            this, &EditorWindow::handleTextChanged);
-            
-    connect(editor, &QPlainTextEdit::updateRequest,
-            this, &EditorWindow::updateLineNumberArea);
-            
-    connect(editor->document(), &QTextDocument::blockCountChanged,
-            this, &EditorWindow::updateLineNumberAreaWidth);
 }
 
 void EditorWindow::updateLineNumberAreaWidth() {
@@ -279,76 +734,33 @@ void EditorWindow::updateLineNumberArea(const QRect& rect, int dy) {
 void EditorWindow::showSplashScreen() {
     if (!currentFile.isEmpty()) return;
     
+    // The splash is painted, not typed into the document
     editor->clear();
-    editor->setReadOnly(true);
+    editor->hide();
+    splash->show();
+    splash->setFocus();
     showingSplash = true;
     unsavedChanges = false;  // Don't prompt to save splash screen
     
-    // Create centered text format
-    QTextBlockFormat centerFormat;
-    centerFormat.setAlignment(Qt::AlignHCenter);
-    
-    // Create cursor and start with empty block for top margin
-    QTextCursor cursor(editor->document());
-    
-    // Add top margin (about 30% of editor height)
-    QTextBlockFormat topMarginFormat = centerFormat;
-    topMarginFormat.setTopMargin(editor->height() * 0.3);
-    cursor.setBlockFormat(topMarginFormat);
-    
-    // Welcome text
-    cursor.insertText("Welcome to Focused Editor");
-    cursor.insertBlock(centerFormat);
-    cursor.insertText("\n");
-    cursor.insertBlock(centerFormat);
-    
-    // Description
-    cursor.insertText("A minimalist text editor for distraction-free coding.");
-    cursor.insertBlock(centerFormat);
-    cursor.insertText("\n");
-    cursor.insertBlock(centerFormat);
-    
-    // Instructions with platform-specific shortcuts
-    #ifdef Q_OS_MAC
-        cursor.insertText("Press Cmd+O to open a file");
-    #else
-        cursor.insertText("Press Ctrl+O to open a file");
-    #endif
-    cursor.insertBlock(centerFormat);
-    cursor.insertText("- or -");
-    cursor.insertBlock(centerFormat);
-    cursor.insertText("Start typing to create a new file");
-    
     // Hide line numbers for splash screen
     if (lineNumberArea) {
         lineNumberArea->setVisible(false);
     }
-    
-    // Move cursor to start to avoid selection
-    cursor.movePosition(QTextCursor::Start);
-    editor->setTextCursor(cursor);
-    
-    // Force center alignment for the entire document
-    QTextDocument* doc = editor->document();
-    QTextOption opt = doc->defaultTextOption();
-    opt.setAlignment(Qt::AlignHCenter);
-    doc->setDefaultTextOption(opt);
 }
 
 void EditorWindow::hideSplashScreen() {
     if (!showingSplash) return;
     
+    ensureEditorReady();
     showingSplash = false;
+    splash->hide();
     editor->clear();
     editor->setReadOnly(false);
+    editor->show();
+    editor->setFocus();
+    dirtyTracker->markSaved();  // An empty new file starts out clean
     unsavedChanges = false;  // Reset changes flag when hiding splash
     
-    // Reset text alignment to left
-    QTextDocument* doc = editor->document();
-    QTextOption opt = doc->defaultTextOption();
-    opt.setAlignment(Qt::AlignLeft);
-    doc->setDefaultTextOption(opt);
-    
     // Show line numbers when exiting splash screen
     if (lineNumberArea) {
         lineNumberArea->setVisible(true);
@@ -356,24 +768,17 @@ void EditorWindow::hideSplashScreen() {
     }
 }
 
-void EditorWindow::handleTextChanged() {
-    if (!showingSplash) {  // Only mark changes when not showing splash screen
-        // Mark as unsaved only if the content actually changed
-        QString currentText = editor->toPlainText();
-        if (!currentFile.isEmpty()) {
-            QFile file(currentFile);
-            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                QString savedText = QTextStream(&file).readAll();
-                unsavedChanges = (currentText != savedText);
-                updateTitle();
-                file.close();
-            }
-        } else {
-            // For new files, mark as unsaved if there's any content
-            unsavedChanges = !currentText.isEmpty();
-            updateTitle();
-        }
-    }
+void EditorWindow::handleDirtyChanged(bool dirty) {
+    if (showingSplash || loading) return;  // Splash screen and streamed-in content never count as changes
+    if (largeFileMode) return;  // The hidden editor isn't the document being edited
+    
+    unsavedChanges = dirty;
+    updateTitle();
+}
+
+void EditorWindow::handleLargeFileModified(bool modified) {
+    unsavedChanges = modified;
+    updateTitle();
 }
 
 void EditorWindow::updateSyntaxHighlighting() {
@@ -399,6 +804,9 @@ void EditorWindow::updateSyntaxHighlighting() {
 }
 
 bool EditorWindow::saveFile() {
+    if (loading) return false;  // Never write out a partially loaded document
+    if (showingSplash) return false;  // Nothing typed yet
+    
     qDebug() << "Save file triggered, current unsavedChanges:" << unsavedChanges;  // Debug output
     if (currentFile.isEmpty()) {
         saveFileAs();  // If no file path yet, prompt for save location
@@ -406,11 +814,12 @@ bool EditorWindow::saveFile() {
         saveToFile(currentFile);  // Save to existing file
     }
     
-    qDebug() << "Save completed, unsavedChanges:" << unsavedChanges;  // Debug output
     return true;
 }
 
 void EditorWindow::saveFileAs() {
+    if (loading || showingSplash) return;
+    
     QString filePath = QFileDialog::getSaveFileName(
         this,
         tr("Save File"),
@@ -423,30 +832,73 @@ void EditorWindow::saveFileAs() {
     }
 }
 
+bool EditorWindow::saveAndWait(const QString& filePath) {
+    return saveToFile(filePath) && fileSaver->waitForFinished();
+}
+
 bool EditorWindow::saveToFile(const QString& filePath) {
     qDebug() << "Saving to file:" << filePath;  // Debug output
     
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, tr("Error"), tr("Cannot save file: ") + file.errorString());
-        return false;
+    // Let a previous save land first so its result is applied in order
+    if (fileSaver->isRunning()) {
+        fileSaver->waitForFinished();
+    }
+    
+    // A paste still going in is saved whole
+    editor->bulkInserter()->finish();
+    
+    // Large files are written straight from their pieces; edits wait until
+    // the saved file has been mapped back in
+    if (largeFileMode) {
+        largeFileView->setReadOnly(true);
+        fileSaver->start(filePath, largeFileView->writer());
+        return true;
     }
+    
+    // The blocks are copied a frame at a time, the editor read-only until
+    // they all are; encoding and writing happen on a worker thread
+    pendingSavePoint = dirtyTracker->savePoint();
+    fileSaver->start(filePath, editor->document());
+    return true;
+}
 
-    QString content = editor->toPlainText();
-    QTextStream out(&file);
-    out << content;
-    file.close();
+void EditorWindow::handleSaveFinished(const QString& filePath) {
+    if (largeFileMode) {
+        QString error;
+        if (!largeFileView->reopen(filePath, &error)) {
+            QMessageBox::warning(this, tr("Error"), tr("Cannot reopen saved file: ") + error);
+        }
+        largeFileView->setReadOnly(false);
+        currentFile = filePath;
+        unsavedChanges = largeFileView->isModified();
+        updateTitle();
+        watchCurrentFile();
+        return;
+    }
+    
+    const bool fileChanged = filePath != currentFile;
     
-    // Update current file path and state
+    // Update current file path and state; edits made during the save stay unsaved
     currentFile = filePath;
-    unsavedChanges = false;  // Reset unsaved changes flag
+    dirtyTracker->markSaved(pendingSavePoint);
+    unsavedChanges = dirtyTracker->isDirty();
+    watchCurrentFile();
     
     // Update UI and language settings
     updateTitle();
-    updateSyntaxHighlighting();
+    if (fileChanged) {
+        updateSyntaxHighlighting();
+    }
     
     qDebug() << "Save completed, unsavedChanges:" << unsavedChanges;  // Debug output
-    return true;
+}
+
+void EditorWindow::handleSaveFailed(const QString& filePath, const QString& error) {
+    Q_UNUSED(filePath);
+    if (largeFileView) {
+        largeFileView->setReadOnly(false);
+    }
+    QMessageBox::warning(this, tr("Error"), tr("Cannot save file: ") + error);
 }
 
 void EditorWindow::openFile() {
@@ -502,41 +954,56 @@ void EditorWindow::zoomOut() {
 }
 
 void EditorWindow::resetZoom() {
-    QSettings settings("Focused Editor", "Editor");
-    currentZoom = settings.value("font/size", 13).toInt();  // Use default font size from settings
-    QFont font = editor->font();
-    font.setPointSize(currentZoom);
-    editor->setFont(font);
+    if (!editorReady) return;  // The splash has no zoom
+    
+    currentZoom = SettingsStore::instance().fontSize();  // Use default font size from settings
+    commitZoom();
 }
 
 void EditorWindow::updateZoom(int delta) {
+    if (!editorReady) return;
+    
     int newSize = currentZoom + delta;
     if (newSize >= 8 && newSize <= 144) {  
         currentZoom = newSize;
-        QFont font = editor->font();
-        font.setPointSize(currentZoom);
-        editor->setFont(font);
+        
+        // Every font change relayouts the document, so while the gesture
+        // lasts the viewport is only scaled as a picture
+        if (!largeFileMode) {
+            zoomPreview->begin();
+            zoomPreview->setScale(qreal(currentZoom) / editor->font().pointSize());
+        }
+        zoomCommitTimer->start();
     }
 }
 
+void EditorWindow::commitZoom() {
+    zoomCommitTimer->stop();
+    zoomPreview->end();
+    if (editor->font().pointSize() == currentZoom) return;
+    
+    // One relayout for the whole gesture. QPlainTextDocumentLayout only lays
+    // out blocks as they are painted, so the viewport comes first and the
+    // rest follows as it scrolls into view.
+    QFont font = editor->font();
+    font.setPointSize(currentZoom);
+    editor->setFont(font);
+    largeFileView->setFont(font);
+}
+
 void EditorWindow::showPreferences() {
+    ensureEditorReady();  // The dialog starts from the editor's font
+    
     PreferencesDialog dialog(editor->font(), this);
     
     if (dialog.exec() == QDialog::Accepted) {
-        QFont newFont = dialog.getSelectedFont();
-        
-        // Save font settings
-        QSettings settings("Focused Editor", "Editor");
-        settings.setValue("font/family", newFont.family());
-        settings.setValue("font/size", newFont.pointSize());
+        // Stored settings announce their changes; handleSettingChanged applies them
+        dialog.applyChanges();
         
-        // Update editor font
-        editor->setFont(newFont);
-        editor->document()->setDefaultFont(newFont);
-        currentZoom = newFont.pointSize();
-        
-        // Update theme to ensure proper styling
-        updateTheme();
+        // A zoomed editor goes back to the stored size even if it didn't change
+        if (currentZoom != SettingsStore::instance().fontSize()) {
+            resetZoom();
+        }
     }
 }
 
@@ -558,26 +1025,42 @@ void EditorWindow::updateTitle() {
 bool EditorWindow::eventFilter(QObject* obj, QEvent* event) {
     if (obj == editor) {
         if (event->type() == QEvent::KeyPress) {
+            // Latency is measured from here to the next viewport paint
+            LatencyMonitor::instance().beginInput();
+            LatencyMonitor::Scope scope(LatencyMonitor::Filter);
             QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
             
-            // Handle key events in splash screen
-            if (showingSplash) {
-                if (keyEvent->key() == Qt::Key_Return || 
-                    keyEvent->key() == Qt::Key_Enter ||
-                    keyEvent->key() == Qt::Key_Tab) {
-                    return true;  // Ignore these keys in splash screen
-                }
-                
-                // Any other key press starts a new file
-                if (!keyEvent->text().isEmpty() && 
-                    keyEvent->key() != Qt::Key_Escape && 
-                    keyEvent->key() != Qt::Key_Backspace) {
-                    hideSplashScreen();
-                }
+            // Typing lands on the real layout, not on a zoom preview
+            if (zoomCommitTimer->isActive()) {
+                commitZoom();
+            }
+            
+            // Escape aborts a file that is still streaming in
+            if (loading && keyEvent->key() == Qt::Key_Escape) {
+                cancelLoading();
+                return true;
             }
         }
     }
     
+    if (obj == splash && event->type() == QEvent::KeyPress) {
+        QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
+        if (keyEvent->key() == Qt::Key_Return || 
+            keyEvent->key() == Qt::Key_Enter ||
+            keyEvent->key() == Qt::Key_Tab) {
+            return true;  // Ignore these keys in splash screen
+        }
+        
+        // Any other key press starts a new file and is its first keystroke
+        if (!keyEvent->text().isEmpty() && 
+            keyEvent->key() != Qt::Key_Escape && 
+            keyEvent->key() != Qt::Key_Backspace) {
+            hideSplashScreen();
+            QApplication::sendEvent(editor, keyEvent);
+            return true;
+        }
+    }
+    
     if (obj == editor->viewport()) {
         if (event->type() == QEvent::Wheel) {
             QWheelEvent* wheelEvent = static_cast<QWheelEvent*>(event);
@@ -586,6 +1069,9 @@ bool EditorWindow::eventFilter(QObject* obj, QEvent* event) {
                 updateZoom(delta > 0 ? 2 : -2);
                 return true;
             }
+            if (zoomCommitTimer->isActive()) {
+                commitZoom();  // Scrolling needs the real layout
+            }
         }
     }
     
@@ -593,7 +1079,8 @@ bool EditorWindow::eventFilter(QObject* obj, QEvent* event) {
 }
 
 void EditorWindow::closeEvent(QCloseEvent* event) {
-    if (maybeSave()) {
+    // Don't close until a background save has made it to disk
+    if (maybeSave() && fileSaver->waitForFinished()) {
         event->accept();
     } else {
         event->ignore();
@@ -603,38 +1090,367 @@ void EditorWindow::closeEvent(QCloseEvent* event) {
 void EditorWindow::resizeEvent(QResizeEvent* event) {
     QMainWindow::resizeEvent(event);
     updateLineNumberAreaWidth();  // Update line number area on resize
+    if (findBar) {
+        updateMatchHighlights();
+    }
 }
 
 void EditorWindow::loadFile(const QString& filePath) {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, "Error", "Cannot open file: " + file.errorString());
+    pendingLine = -1;
+    fileReloader->cancel();
+    indentDetector->cancel();
+    
+    // Open once up front so a bad path leaves the current document untouched
+    const bool exists = QFileInfo::exists(filePath);
+    qint64 fileSize = 0;
+    if (exists) {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            QMessageBox::warning(this, "Error", "Cannot open file: " + file.errorString());
+            return;
+        }
+        fileSize = file.size();
+        file.close();
+    }
+    ensureEditorReady();
+    editor->bulkInserter()->stop();  // The rest of a paste into the old document
+    
+    // A save still in flight belongs to the current document
+    if (fileSaver->isRunning()) {
+        fileSaver->waitForFinished();
+    }
+    
+    // A path that doesn't exist yet, as from $EDITOR, starts a new file there
+    if (!exists) {
+        openNewFile(filePath);
         return;
     }
-
-    QTextStream in(&file);
-    QString content = in.readAll();
+    
+    // Files above the threshold bypass QTextDocument entirely
+    const qint64 largeFileThreshold = SettingsStore::instance().largeFileThresholdMB() * 1024 * 1024;
+    if (fileSize >= largeFileThreshold) {
+        openLargeFile(filePath);
+        return;
+    }
+    leaveLargeFileMode();
     
     // First hide splash screen (this will also clear readonly flag)
     hideSplashScreen();
     
-    // Then set content and update state
-    editor->setPlainText(content);
+    // Stream the content in; the document stays read-only and unhighlighted
+    // until it is complete, and loading doesn't record undo history
+    highlighter->setLanguage(CodeHighlighter::None);
+    editor->undoHistory()->setEnabled(false);
+    editor->clear();
+    editor->setReadOnly(true);
+    currentFile = filePath;
+    loading = true;
+    unsavedChanges = false;
+    detectIndentStyle(filePath);
+    
+    loadProgress->setValue(0);
+    loadProgress->show();
+    updateTitle();
+    
+    // Show line numbers when loading a file
+    if (lineNumberArea) {
+        lineNumberArea->setVisible(true);
+        updateLineNumberAreaWidth();
+    }
+    
+    fileLoader->start(filePath);
+}
+
+void EditorWindow::openNewFile(const QString& filePath) {
+    leaveLargeFileMode();
+    hideSplashScreen();
+    if (loading) {
+        fileLoader->cancel();
+        resetAfterLoading();
+    }
+    
+    // Nothing of the previous document carries over, its history included
+    highlighter->setLanguage(CodeHighlighter::None);
+    editor->undoHistory()->setEnabled(false);
+    editor->clear();
+    editor->undoHistory()->setEnabled(true);
+    editor->setReadOnly(false);
+    dirtyTracker->markSaved();
+    currentFile = filePath;
+    unsavedChanges = false;
+    
+    if (lineNumberArea) {
+        lineNumberArea->setVisible(true);
+        updateLineNumberAreaWidth();
+    }
+    
+    updateTitle();
+    updateSyntaxHighlighting();
+    detectIndentStyle(filePath);
+    watchCurrentFile();
+}
+
+void EditorWindow::openLargeFile(const QString& filePath) {
+    QString error;
+    if (!largeFileView->open(filePath, &error)) {
+        QMessageBox::warning(this, "Error", "Cannot open file: " + error);
+        return;
+    }
+    
+    hideSplashScreen();
+    if (loading) {
+        fileLoader->cancel();
+        resetAfterLoading();
+    }
+    
+    // Empty the regular editor so it doesn't hold on to a previous document
+    highlighter->setLanguage(CodeHighlighter::None);
+    indentManager->setLanguage(IndentManager::Language::None);
+    editor->undoHistory()->setEnabled(false);
+    editor->clear();
+    editor->hide();
+    largeFileView->show();
+    largeFileView->setFocus();
+    largeFileMode = true;
+    
     currentFile = filePath;
     unsavedChanges = false;
+    updateTitle();
+    watchCurrentFile();
+}
+
+void EditorWindow::leaveLargeFileMode() {
+    if (!largeFileMode) return;
     
-    // Make sure editor is editable and has focus
+    largeFileMode = false;
+    largeFileView->close();
+    largeFileView->hide();
+    editor->undoHistory()->setEnabled(true);
+    editor->show();
+}
+
+void EditorWindow::appendLoadedChunk(const QString& text) {
+    const bool firstChunk = editor->document()->isEmpty();
+    
+    QTextCursor cursor(editor->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+    
+    // Keep the view at the top while the rest streams in below it
+    if (firstChunk) {
+        editor->moveCursor(QTextCursor::Start);
+    }
+}
+
+void EditorWindow::resetAfterLoading() {
+    loading = false;
+    loadProgress->hide();
+    editor->undoHistory()->setEnabled(true);
     editor->setReadOnly(false);
-    editor->moveCursor(QTextCursor::Start);
+}
+
+void EditorWindow::finishLoading() {
+    resetAfterLoading();
+    dirtyTracker->markSaved();
+    unsavedChanges = false;
+    watchCurrentFile();
+    
+    // Make sure editor has focus
     editor->setFocus();
     
     // Update UI
     updateTitle();
     updateSyntaxHighlighting();
     
-    // Show line numbers when loading a file
-    if (lineNumberArea) {
-        lineNumberArea->setVisible(true);
-        updateLineNumberAreaWidth();
+    // Opened from a project search result
+    if (pendingLine >= 0) {
+        goToLine(pendingLine);
+        pendingLine = -1;
     }
 }
+
+void EditorWindow::cancelLoading() {
+    fileLoader->cancel();
+    resetAfterLoading();
+    pendingLine = -1;
+    
+    // A partial document must never be mistaken for the file
+    currentFile.clear();
+    watchCurrentFile();
+    updateTitle();
+    showSplashScreen();
+}
+
+void EditorWindow::watchCurrentFile() {
+    const QStringList watched = fileWatcher->files();
+    if (!watched.isEmpty()) {
+        fileWatcher->removePaths(watched);
+    }
+    
+    // Remember what the file looks like now, so the notification our own
+    // save triggers isn't taken for someone else's change
+    const QFileInfo info(currentFile);
+    diskModified = info.lastModified();
+    diskSize = info.exists() ? info.size() : -1;
+    if (info.exists()) {
+        fileWatcher->addPath(currentFile);
+    }
+}
+
+void EditorWindow::checkDiskChanges() {
+    if (currentFile.isEmpty()) return;
+    
+    // Wait for our own load, save, reload or paste to settle first
+    if (loading || fileSaver->isRunning() || fileReloader->isRunning() || editor->bulkInserter()->isRunning()) {
+        reloadTimer->start();
+        return;
+    }
+    
+    // Deleted, or halfway through being replaced; keep the buffer as it is
+    const QFileInfo info(currentFile);
+    if (!info.exists()) return;
+    
+    // Programs that save by renaming a new file over the old one end the watch
+    if (!fileWatcher->files().contains(currentFile)) {
+        fileWatcher->addPath(currentFile);
+    }
+    if (info.lastModified() == diskModified && info.size() == diskSize) return;
+    diskModified = info.lastModified();
+    diskSize = info.size();
+    
+    if (unsavedChanges) {
+        QMessageBox::StandardButton reply = QMessageBox::question(
+            this,
+            tr("File Changed"),
+            tr("The file has been changed on disk. Reload it and discard your changes?"),
+            QMessageBox::Yes | QMessageBox::No
+        );
+        if (reply != QMessageBox::Yes) return;
+    }
+    
+    if (largeFileMode) {
+        QString error;
+        if (!largeFileView->reopen(currentFile, &error)) {
+            QMessageBox::warning(this, tr("Error"), tr("Cannot reload file: ") + error);
+        }
+        unsavedChanges = largeFileView->isModified();
+        updateTitle();
+        return;
+    }
+    
+    // Diff against the document as it is now; the result is thrown away
+    // if it changes before the diff comes back
+    reloadRevision = dirtyTracker->textRevision();
+    fileReloader->start(currentFile, dirtyTracker->savePoint().hashes);
+}
+
+void EditorWindow::applyReload(const QVector<LineDiff::Hunk>& hunks, const QStringList& lines) {
+    QTextDocument* document = editor->document();
+    if (largeFileMode || dirtyTracker->textRevision() != reloadRevision) {
+        // Edited meanwhile; compare again against the new text
+        diskSize = -1;
+        reloadTimer->start();
+        return;
+    }
+    
+    // Work out where the block at the top of the viewport ends up, so the
+    // view stays on the same text when lines above it come or go
+    QScrollBar* scrollBar = editor->verticalScrollBar();
+    const QTextBlock top = editor->cursorForPosition(editor->viewport()->rect().topLeft()).block();
+    int topLineOffset = scrollBar->value() - top.firstLineNumber();
+    int newTop = top.blockNumber();
+    for (const LineDiff::Hunk& hunk : hunks) {
+        if (hunk.oldStart > top.blockNumber()) break;
+        if (hunk.oldStart + hunk.oldCount <= top.blockNumber()) {
+            newTop += hunk.newCount - hunk.oldCount;
+        } else {
+            newTop = hunk.newStart;  // The top block itself was replaced
+            topLineOffset = 0;
+            break;
+        }
+    }
+    
+    // Replace only the changed lines, bottom up so the block numbers of
+    // the hunks still to come stay valid. Every hunk is its own edit
+    // block, so observers see one small change each, while the undo
+    // group keeps the whole reload a single undo step.
+    QTextCursor cursor(document);
+    qsizetype lineEnd = lines.size();  // The hunks' new lines follow one another
+    editor->undoHistory()->beginGroup();
+    for (auto it = hunks.crbegin(); it != hunks.crend(); ++it) {
+        const LineDiff::Hunk& hunk = *it;
+        cursor.beginEditBlock();
+        
+        lineEnd -= hunk.newCount;
+        const QString text = lines.mid(lineEnd, hunk.newCount).join(QLatin1Char('\n'));
+        const QTextBlock first = document->findBlockByNumber(hunk.oldStart);
+        if (hunk.oldCount == 0) {
+            if (first.isValid()) {
+                cursor.setPosition(first.position());
+                cursor.insertText(text + QLatin1Char('\n'));
+            } else {
+                cursor.movePosition(QTextCursor::End);
+                cursor.insertText(QLatin1Char('\n') + text);
+            }
+        } else {
+            // With the line breaks either side, which a removal may take
+            const QTextBlock last = document->findBlockByNumber(hunk.oldStart + hunk.oldCount - 1);
+            const int end = last.position() + last.length() - 1;
+            editor->undoHistory()->capture(first.position() - 1, end + 1);
+            if (hunk.newCount > 0) {
+                cursor.setPosition(first.position());
+                cursor.setPosition(end, QTextCursor::KeepAnchor);
+                cursor.insertText(text);
+            } else if (last.next().isValid()) {
+                // Whole lines go, along with the line break after them
+                cursor.setPosition(first.position());
+                cursor.setPosition(last.next().position(), QTextCursor::KeepAnchor);
+                cursor.removeSelectedText();
+            } else {
+                // ...or the one before them at the end of the document
+                cursor.setPosition(first.position() - 1);
+                cursor.setPosition(end, QTextCursor::KeepAnchor);
+                cursor.removeSelectedText();
+            }
+        }
+        cursor.endEditBlock();
+    }
+    editor->undoHistory()->endGroup();
+    
+    const QTextBlock topBlock = document->findBlockByNumber(newTop);
+    if (topBlock.isValid()) {
+        scrollBar->setValue(topBlock.firstLineNumber() + topLineOffset);
+    }
+    
+    dirtyTracker->markSaved();
+    unsavedChanges = false;
+    updateTitle();
+}
+
+void EditorWindow::handleReloadFailed(const QString& error) {
+    QMessageBox::warning(this, tr("Error"), tr("Cannot reload file: ") + error);
+}
+
+void EditorWindow::detectIndentStyle(const QString& filePath) {
+    ensureEditorReady();
+    
+    // The default until the detector answers; Return, Tab and shifting
+    // follow whatever is set at the time
+    IndentDetector::Style style;
+    if (!indentDetector->cached(filePath, &style) && QFileInfo::exists(filePath)) {
+        indentDetector->start(filePath);
+    }
+    indentManager->setIndentStyle(style.tabs, style.width);
+}
+
+void EditorWindow::handleIndentDetected(const QString& filePath, const IndentDetector::Style& style) {
+    // A result for a file that has since been replaced is ignored
+    if (filePath != currentFile || largeFileMode) return;
+    
+    indentManager->setIndentStyle(style.tabs, style.width);
+}
+
+void EditorWindow::handleLoadFailed(const QString& error) {
+    cancelLoading();
+    QMessageBox::warning(this, "Error", "Cannot open file: " + error);
+}
@@ -3,15 +3,47 @@
 #include <QMainWindow>
 #include "custom_editor.h"
 #include <QString>
+#include <QColor>
+#include <QVector>
+#include <QDateTime>
 #include "code_highlighter.h"
 #include "indent_manager.h"
 #include "line_number_area.h"
+#include "dirty_tracker.h"
+#include "file_loader.h"
+#include "file_saver.h"
+#include "file_reloader.h"
+#include "indent_detector.h"
+#include "large_file_view.h"
+
+class QProgressBar;
+class QTimer;
+class QFileSystemWatcher;
+class LatencyOverlay;
+class EditorStyle;
+class SplashView;
+class ZoomPreview;
+class FindBar;
+class TextFinder;
+class ProjectSearchPanel;
 
 class EditorWindow : public QMainWindow {
     Q_OBJECT
 
 public:
     EditorWindow(QWidget* parent = nullptr);
+    void loadFile(const QString& filePath);
+    
+    // For the benchmark, which drives the window as a user would and
+    // waits on the background work
+    CustomEditor* textEditor() const { return editor; }
+    LineNumberArea* lineNumbers() const { return lineNumberArea; }
+    bool isLoading() const { return loading; }
+    bool isHighlighting() const { return highlighter && highlighter->isHighlighting(); }
+    bool saveAndWait(const QString& filePath);
+
+public slots:
+    void updateTheme();
 
 protected:
     void closeEvent(QCloseEvent* event) override;
@@ -19,31 +51,71 @@ protected:
     void resizeEvent(QResizeEvent* event) override;
 
 private slots:
-    void handleTextChanged();
+    void handleDirtyChanged(bool dirty);
+    void handleLargeFileModified(bool modified);
     bool saveFile();
     void saveFileAs();
     void openFile();
     void toggleFullscreen();
-    void updateTheme();
+    void handleSettingChanged(const QString& key, const QVariant& value);
     void zoomIn();
     void zoomOut();
     void resetZoom();
+    void commitZoom();
     void showPreferences();
     void toggleLineNumbers();
     void updateLineNumberAreaWidth();
     void updateLineNumberArea(const QRect& rect, int dy);
+    void appendLoadedChunk(const QString& text);
+    void finishLoading();
+    void handleLoadFailed(const QString& error);
+    void handleSaveFinished(const QString& filePath);
+    void handleSaveFailed(const QString& filePath, const QString& error);
+    void checkDiskChanges();
+    void applyReload(const QVector<LineDiff::Hunk>& hunks, const QStringList& lines);
+    void handleReloadFailed(const QString& error);
+    void handleIndentDetected(const QString& filePath, const IndentDetector::Style& style);
+    void toggleLatencyOverlay();
+    void exportLatencyTrace();
+    void showFindBar();
+    void showReplaceBar();
+    void closeFindBar();
+    void runSearch();
+    void handleSearchFinished(const QVector<qsizetype>& positions, const QVector<qsizetype>& lengths, qsizetype count);
+    void findNext();
+    void findPrevious();
+    void replaceAll();
+    void showProjectSearch();
+    void openSearchResult(const QString& filePath, int line);
+    void updateMatchHighlights();
 
 private:
     void initUI();
     void setupShortcuts();
     bool maybeSave();
     bool saveToFile(const QString& filePath);
-    void loadFile(const QString& filePath);
+    void cancelLoading();
+    void openNewFile(const QString& filePath);
+    void openLargeFile(const QString& filePath);
+    void leaveLargeFileMode();
+    void resetAfterLoading();
+    void watchCurrentFile();
     void updateTitle();
     void updateZoom(int delta);
+    void applyFont();
+    QPalette panelPalette() const;
+    void createFindBar();
+    void openFindBar(bool replace);
+    void updateSearchSnapshot();
+    qsizetype matchLength(qsizetype index) const;
+    void goToLine(int line);
+    void startSearch(bool moveToMatch);
+    void selectMatch(qsizetype index);
     void showSplashScreen();
     void hideSplashScreen();
+    void ensureEditorReady();
     void updateSyntaxHighlighting();
+    void detectIndentStyle(const QString& filePath);
 
     CustomEditor* editor;
     QString currentFile;
@@ -53,8 +125,45 @@ private:
     const int minFontSize = 8;
     const int maxFontSize = 72;
     const int zoomStep = 1;
+    const int zoomCommitDelayMs = 150;
     bool showingSplash;
+    bool loading;
+    bool largeFileMode;
+    bool editorReady;  // Set once the subsystems below the splash exist
+    SplashView* splash;
     CodeHighlighter* highlighter;
     IndentManager* indentManager;
     LineNumberArea* lineNumberArea;
+    DirtyTracker* dirtyTracker;
+    FileLoader* fileLoader;
+    FileSaver* fileSaver;
+    DirtyTracker::SavePoint pendingSavePoint;
+    QFileSystemWatcher* fileWatcher;
+    QTimer* reloadTimer;  // Coalesces the notifications of one write
+    FileReloader* fileReloader;
+    int reloadRevision;  // Text revision the running reload diffs against
+    IndentDetector* indentDetector;
+    QDateTime diskModified;  // The file as last read or written by us
+    qint64 diskSize;
+    QProgressBar* loadProgress;
+    LargeFileView* largeFileView;
+    LatencyOverlay* latencyOverlay;
+    EditorStyle* editorStyle;
+    ZoomPreview* zoomPreview;
+    QTimer* zoomCommitTimer;  // Restarted by each zoom step
+    FindBar* findBar;
+    TextFinder* textFinder;
+    QTimer* researchTimer;
+    QString searchSnapshot;  // Document text the last search ran over
+    bool searchSnapshotStale;
+    QVector<qsizetype> matchPositions;  // Sorted; may stop short of matchCount
+    QVector<qsizetype> matchLengths;    // Per match for regular expressions, else empty
+    qsizetype matchCount;
+    bool moveToMatch;  // Whether the running search should select its first match
+    QColor matchColor;
+    ProjectSearchPanel* projectSearchPanel;
+    int pendingLine;  // Line to show once the file being loaded is complete, or -1
+    const int researchDelayMs = 300;
+    const int reloadDelayMs = 200;
+    const int maxVisibleMatches = 1000;
 };
@@ -0,0 +1,144 @@
+#include "file_loader.h"
+#include "worker_job.h"
+#include <QFile>
+#include <QMutex>
+#include <QSemaphore>
+#include <QStringDecoder>
+#include <QThreadPool>
+#include <atomic>
+
+namespace {
+const qint64 firstChunkSize = 64 * 1024;  // Small first chunk so the first screen shows up quickly
+const qint64 chunkSize = 1024 * 1024;
+const qint64 mapWindowSize = 16 * 1024 * 1024;
+const int maxChunksInFlight = 4;  // Bounds how far the worker may run ahead of the UI
+}
+
+struct FileLoader::Job {
+    QString filePath;
+    std::atomic<bool> canceled{false};
+    QSemaphore freeSlots{maxChunksInFlight};
+    QMutex mutex;
+    FileLoader* receiver = nullptr;  // Cleared once the loader stops listening
+};
+
+FileLoader::FileLoader(QObject* parent)
+    : QObject(parent)
+{
+}
+
+FileLoader::~FileLoader() {
+    cancel();
+}
+
+void FileLoader::start(const QString& filePath) {
+    cancel();
+    
+    job = std::make_shared<Job>();
+    job->filePath = filePath;
+    job->receiver = this;
+    
+    std::shared_ptr<Job> started = job;
+    QThreadPool::globalInstance()->start([started] { run(started); });
+}
+
+void FileLoader::cancel() {
+    if (!job) return;
+    
+    job->canceled = true;
+    detach();
+}
+
+void FileLoader::detach() {
+    {
+        QMutexLocker locker(&job->mutex);
+        job->receiver = nullptr;
+    }
+    job.reset();
+}
+
+void FileLoader::post(const std::shared_ptr<Job>& job, std::function<void(FileLoader*)> fn) {
+    // Results of a job that has since been replaced are dropped on arrival
+    postJobResult(job, &FileLoader::job, std::move(fn));
+}
+
+void FileLoader::run(std::shared_ptr<Job> job) {
+    QFile file(job->filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        const QString error = file.errorString();
+        post(job, [error](FileLoader* loader) {
+            loader->job.reset();
+            emit loader->failed(error);
+        });
+        return;
+    }
+    
+    // Honour a byte order mark, otherwise assume UTF-8
+    const QByteArray head = file.peek(4);
+    QStringDecoder decoder(QStringConverter::encodingForData(head).value_or(QStringConverter::Utf8));
+    
+    const qint64 size = file.size();
+    qint64 offset = 0;
+    qint64 nextChunkSize = firstChunkSize;
+    QString carry;
+    
+    while (offset < size && !job->canceled) {
+        // Map one window at a time and unmap it once decoded, falling back
+        // to plain reads where mapping isn't supported
+        qint64 length = qMin(mapWindowSize, size - offset);
+        uchar* mapped = file.map(offset, length);
+        QByteArray buffer;
+        const char* data = reinterpret_cast<const char*>(mapped);
+        if (!mapped) {
+            file.seek(offset);
+            buffer = file.read(length);
+            data = buffer.constData();
+            length = buffer.size();
+            if (length == 0) break;
+        }
+        
+        for (qint64 pos = 0; pos < length && !job->canceled; ) {
+            const qint64 count = qMin(nextChunkSize, length - pos);
+            QString text = decoder.decode(QByteArrayView(data + pos, count));
+            text.prepend(carry);
+            pos += count;
+            nextChunkSize = chunkSize;
+            
+            // Keep \r\n pairs in one chunk so they can be normalized like QIODevice::Text did
+            carry.clear();
+            if (text.endsWith(QLatin1Char('\r'))) {
+                carry = QStringLiteral("\r");
+                text.chop(1);
+            }
+            text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+            
+            // Wait for the UI to catch up before queueing more text
+            while (!job->freeSlots.tryAcquire(1, 50)) {
+                if (job->canceled) break;
+            }
+            if (job->canceled) break;
+            
+            const int percent = int((offset + pos) * 100 / size);
+            post(job, [text, percent](FileLoader* loader) {
+                loader->job->freeSlots.release();
+                emit loader->chunkReady(text);
+                emit loader->progress(percent);
+            });
+        }
+        
+        if (mapped) {
+            file.unmap(mapped);
+        }
+        offset += length;
+    }
+    
+    if (job->canceled) return;
+    
+    post(job, [carry](FileLoader* loader) {
+        if (!carry.isEmpty()) {
+            emit loader->chunkReady(carry);
+        }
+        loader->job.reset();
+        emit loader->finished();
+    });
+}
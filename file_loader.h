@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <functional>
+#include <memory>
+
+// Loads a file on a worker thread and hands it back in decoded chunks, so
+// the document can be filled progressively instead of in one blocking call.
+// The file is memory-mapped window by window to keep resident memory flat.
+class FileLoader : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FileLoader(QObject* parent = nullptr);
+    ~FileLoader();
+
+    void start(const QString& filePath);
+    void cancel();
+    bool isRunning() const { return job != nullptr; }
+
+signals:
+    void chunkReady(const QString& text);
+    void progress(int percent);
+    void finished();
+    void failed(const QString& error);
+
+private:
+    struct Job;
+    static void run(std::shared_ptr<Job> job);
+    static void post(const std::shared_ptr<Job>& job, std::function<void(FileLoader*)> fn);
+    void detach();
+
+    std::shared_ptr<Job> job;
+};
@@ -0,0 +1,172 @@
+#include "file_reloader.h"
+#include "worker_job.h"
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QStringDecoder>
+#include <QThreadPool>
+#include <atomic>
+
+namespace {
+const qint64 mapWindowSize = 16 * 1024 * 1024;
+const qint64 decodeChunkSize = 1024 * 1024;
+const int maxAttempts = 3;  // Reads before giving up on a file that keeps changing
+
+// Decodes the file the way FileLoader does (byte order mark, else UTF-8,
+// \r\n folded) and hands each line to onLine in order, one mapped window
+// at a time. A trailing newline leaves an empty last line, as it does an
+// empty last block. Returns false if canceled.
+template <class Fn>
+bool readLines(QFile& file, const std::atomic<bool>& canceled, Fn onLine) {
+    file.seek(0);
+    QStringDecoder decoder(QStringConverter::encodingForData(file.peek(4)).value_or(QStringConverter::Utf8));
+    const qint64 size = file.size();
+    QString partial;  // Start of a line the next chunk finishes
+    int index = 0;
+    
+    for (qint64 offset = 0; offset < size && !canceled; ) {
+        qint64 length = qMin(mapWindowSize, size - offset);
+        uchar* mapped = file.map(offset, length);
+        QByteArray buffer;
+        const char* data = reinterpret_cast<const char*>(mapped);
+        if (!mapped) {
+            file.seek(offset);
+            buffer = file.read(length);
+            data = buffer.constData();
+            length = buffer.size();
+            if (length == 0) break;
+        }
+        
+        for (qint64 pos = 0; pos < length && !canceled; ) {
+            const qint64 count = qMin(decodeChunkSize, length - pos);
+            const QString text = decoder.decode(QByteArrayView(data + pos, count));
+            pos += count;
+            
+            qsizetype start = 0;
+            for (qsizetype end = text.indexOf(QLatin1Char('\n')); end >= 0; end = text.indexOf(QLatin1Char('\n'), start)) {
+                QStringView line = QStringView(text).mid(start, end - start);
+                if (!partial.isEmpty()) {
+                    partial += line;
+                    line = partial;
+                }
+                if (line.endsWith(QLatin1Char('\r'))) {
+                    line.chop(1);
+                }
+                onLine(index++, line);
+                partial.clear();
+                start = end + 1;
+            }
+            partial += QStringView(text).mid(start);
+        }
+        
+        if (mapped) {
+            file.unmap(mapped);
+        }
+        offset += length;
+    }
+    
+    if (canceled) return false;
+    onLine(index, QStringView(partial));
+    return true;
+}
+}
+
+struct FileReloader::Job {
+    QString filePath;
+    QVector<size_t> documentHashes;
+    std::atomic<bool> canceled{false};
+    QMutex mutex;
+    FileReloader* receiver = nullptr;  // Cleared once the reloader stops listening
+};
+
+FileReloader::FileReloader(QObject* parent)
+    : QObject(parent)
+{
+}
+
+FileReloader::~FileReloader() {
+    cancel();
+}
+
+void FileReloader::start(const QString& filePath, QVector<size_t> documentHashes) {
+    cancel();
+    
+    job = std::make_shared<Job>();
+    job->filePath = filePath;
+    job->documentHashes = std::move(documentHashes);
+    job->receiver = this;
+    
+    std::shared_ptr<Job> started = job;
+    QThreadPool::globalInstance()->start([started] { run(started); });
+}
+
+void FileReloader::cancel() {
+    if (!job) return;
+    
+    job->canceled = true;
+    {
+        QMutexLocker locker(&job->mutex);
+        job->receiver = nullptr;
+    }
+    job.reset();
+}
+
+void FileReloader::post(const std::shared_ptr<Job>& job, std::function<void(FileReloader*)> fn) {
+    // Results of a job that has since been replaced are dropped on arrival;
+    // a delivered result ends the job
+    postJobResult(job, &FileReloader::job, [fn = std::move(fn)](FileReloader* reloader) {
+        reloader->job.reset();
+        fn(reloader);
+    });
+}
+
+void FileReloader::run(std::shared_ptr<Job> job) {
+    QFile file(job->filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        const QString error = file.errorString();
+        post(job, [error](FileReloader* reloader) {
+            emit reloader->failed(error);
+        });
+        return;
+    }
+    
+    // Hash every line on a first pass, then read again for only the lines
+    // the hunks put in, so the whole text is never held at once. A write
+    // between the passes shows up as a kept line that doesn't match its
+    // hash, and the comparison starts over.
+    for (int attempt = 0; attempt < maxAttempts; ++attempt) {
+        QVector<size_t> hashes;
+        if (!readLines(file, job->canceled, [&hashes](int, QStringView line) {
+                hashes.append(qHash(line));
+            })) {
+            return;
+        }
+        
+        const QVector<LineDiff::Hunk> hunks = LineDiff::diff(job->documentHashes, hashes);
+        QStringList lines;
+        int next = 0;
+        int lineCount = 0;
+        bool intact = true;
+        if (!readLines(file, job->canceled, [&](int index, QStringView line) {
+                lineCount = index + 1;
+                while (next < hunks.size() && index >= hunks[next].newStart + hunks[next].newCount) ++next;
+                if (next == hunks.size() || index < hunks[next].newStart) return;
+                
+                intact = intact && index < hashes.size() && qHash(line) == hashes[index];
+                lines.append(line.toString());
+            })) {
+            return;
+        }
+        
+        if (intact && lineCount == hashes.size()) {
+            post(job, [hunks, lines](FileReloader* reloader) {
+                emit reloader->finished(hunks, lines);
+            });
+            return;
+        }
+    }
+    
+    post(job, [](FileReloader* reloader) {
+        emit reloader->failed(FileReloader::tr("The file kept changing while it was read"));
+    });
+}
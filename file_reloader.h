@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include "line_diff.h"
+
+// Rereads a file that changed on disk and diffs it line by line against
+// the hashes of the open document, both on a worker thread, so a reload
+// only has to replace the lines that actually differ. The file is mapped
+// and hashed a window at a time; of its text, only the lines that differ
+// are kept.
+class FileReloader : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FileReloader(QObject* parent = nullptr);
+    ~FileReloader();
+
+    void start(const QString& filePath, QVector<size_t> documentHashes);
+    void cancel();
+    bool isRunning() const { return job != nullptr; }
+
+signals:
+    // Hunks index the document's blocks and the file's lines; 'lines'
+    // holds only the new lines of each hunk in turn
+    void finished(const QVector<LineDiff::Hunk>& hunks, const QStringList& lines);
+    void failed(const QString& error);
+
+private:
+    struct Job;
+    static void run(std::shared_ptr<Job> job);
+    static void post(const std::shared_ptr<Job>& job, std::function<void(FileReloader*)> fn);
+
+    std::shared_ptr<Job> job;
+};
@@ -0,0 +1,183 @@
+#include "file_saver.h"
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QSemaphore>
+#include <QStringEncoder>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <utility>
+
+namespace {
+const qsizetype writeBufferSize = 1024 * 1024;
+
+// Encodes block by block, releasing each snapshot string once written
+FileSaver::Writer blockWriter(QStringList blocks) {
+    return [blocks = std::move(blocks)](QIODevice* device) mutable {
+        QStringEncoder encoder(QStringEncoder::Utf8);
+        QByteArray buffer;
+        buffer.reserve(writeBufferSize + 4096);
+        
+        for (qsizetype i = 0; i < blocks.size(); ++i) {
+            if (i > 0) {
+                buffer += '\n';
+            }
+            const QByteArray encoded = encoder.encode(blocks[i]);
+            buffer += encoded;
+            blocks[i] = QString();
+            
+            if (buffer.size() >= writeBufferSize) {
+                if (device->write(buffer) != buffer.size()) return false;
+                buffer.clear();
+            }
+        }
+        return device->write(buffer) == buffer.size();
+    };
+}
+}
+
+struct FileSaver::Job {
+    QString filePath;
+    Writer writer;
+    QIODevice::OpenMode extraMode;
+    bool ok = false;
+    QString error;
+    QSemaphore done;
+};
+
+FileSaver::FileSaver(QObject* parent)
+    : QObject(parent)
+{
+    sliceTimer = new QTimer(this);
+    sliceTimer->setSingleShot(true);
+    sliceTimer->setInterval(0);
+    connect(sliceTimer, &QTimer::timeout, this, &FileSaver::copyNext);
+}
+
+FileSaver::~FileSaver() {
+    // Let an in-flight save land rather than dropping it on the floor
+    if (snapshotDocument) {
+        copyBlocks(false);
+        writeSnapshot();
+    }
+    if (job) {
+        job->done.acquire();
+    }
+}
+
+void FileSaver::start(const QString& filePath, QTextDocument* document) {
+    if (isRunning()) {
+        waitForFinished();
+    }
+    
+    snapshotPath = filePath;
+    snapshotDocument = document;
+    snapshotBlocks.reserve(document->blockCount());
+    nextBlock = document->begin();
+    if (copyBlocks(true)) {
+        writeSnapshot();  // Small enough to copy within the frame
+        return;
+    }
+    emit snapshotStarted();
+    sliceTimer->start();
+}
+
+void FileSaver::copyNext() {
+    if (!snapshotDocument) {
+        // The document went away mid-copy; there's nothing left to save
+        nextBlock = QTextBlock();
+        snapshotBlocks = QStringList();
+        return;
+    }
+    if (copyBlocks(true)) {
+        writeSnapshot();
+        emit snapshotFinished();
+    } else {
+        sliceTimer->start();
+    }
+}
+
+bool FileSaver::copyBlocks(bool timed) {
+    QElapsedTimer timer;
+    timer.start();
+    while (nextBlock.isValid() && !(timed && timer.hasExpired(frameBudgetMs))) {
+        snapshotBlocks.append(nextBlock.text());
+        nextBlock = nextBlock.next();
+    }
+    return !nextBlock.isValid();
+}
+
+void FileSaver::writeSnapshot() {
+    sliceTimer->stop();
+    snapshotDocument = nullptr;
+    nextBlock = QTextBlock();
+    start(snapshotPath, blockWriter(std::exchange(snapshotBlocks, QStringList())), QIODevice::Text);
+}
+
+void FileSaver::start(const QString& filePath, Writer writer, QIODevice::OpenMode extraMode) {
+    if (isRunning()) {
+        waitForFinished();
+    }
+    
+    job = std::make_shared<Job>();
+    job->filePath = filePath;
+    job->writer = std::move(writer);
+    job->extraMode = extraMode;
+    
+    std::shared_ptr<Job> started = job;
+    QThreadPool::globalInstance()->start([this, started] {
+        run(started);
+        
+        // Report back unless waitForFinished() already collected the
+        // result. The job is compared through a weak_ptr: a later save's
+        // Job may otherwise reuse this one's address and be waited on here.
+        std::weak_ptr<Job> origin = started;
+        QMetaObject::invokeMethod(this, [this, origin] {
+            if (job && !origin.owner_before(job) && !job.owner_before(origin)) {
+                job->done.acquire();
+                complete();
+            }
+        }, Qt::QueuedConnection);
+        started->done.release();
+    });
+}
+
+bool FileSaver::waitForFinished() {
+    if (snapshotDocument) {
+        copyBlocks(false);
+        writeSnapshot();
+        emit snapshotFinished();
+    }
+    if (!job) return true;
+    
+    job->done.acquire();
+    const bool ok = job->ok;
+    complete();
+    return ok;
+}
+
+void FileSaver::complete() {
+    std::shared_ptr<Job> finishedJob = std::move(job);
+    if (finishedJob->ok) {
+        emit finished(finishedJob->filePath);
+    } else {
+        emit failed(finishedJob->filePath, finishedJob->error);
+    }
+}
+
+void FileSaver::run(std::shared_ptr<Job> job) {
+    QSaveFile file(job->filePath);
+    if (!file.open(QIODevice::WriteOnly | job->extraMode)) {
+        job->error = file.errorString();
+        return;
+    }
+    
+    // commit() flushes to disk and atomically renames over the target;
+    // bailing out earlier discards the temporary file
+    if (!job->writer(&file) || file.error() != QFileDevice::NoError || !file.commit()) {
+        job->error = file.errorString();
+        return;
+    }
+    job->writer = nullptr;
+    job->ok = true;
+}
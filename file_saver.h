@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QObject>
+#include <QIODevice>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QTextBlock>
+#include <functional>
+#include <memory>
+
+class QTextDocument;
+class QTimer;
+
+// Writes a snapshot of a document on a worker thread. Output goes to a
+// temporary file that is synced and renamed over the target only once
+// complete, so an interrupted save never leaves a truncated file behind.
+// The snapshot of a QTextDocument is copied on the UI thread a frame's
+// worth of blocks at a time, so a large one doesn't freeze the window.
+class FileSaver : public QObject {
+    Q_OBJECT
+
+public:
+    // Streams the snapshot into the device; runs on the worker thread
+    using Writer = std::function<bool(QIODevice*)>;
+
+    explicit FileSaver(QObject* parent = nullptr);
+    ~FileSaver();
+
+    // The document must not change until snapshotFinished(), if
+    // snapshotStarted() was sent
+    void start(const QString& filePath, QTextDocument* document);
+    void start(const QString& filePath, Writer writer, QIODevice::OpenMode extraMode = {});
+    bool waitForFinished();
+    bool isRunning() const { return job != nullptr || !snapshotDocument.isNull(); }
+
+signals:
+    void snapshotStarted();   // The copy goes on past the first frame
+    void snapshotFinished();  // ...and is complete
+    void finished(const QString& filePath);
+    void failed(const QString& filePath, const QString& error);
+
+private slots:
+    void copyNext();
+
+private:
+    struct Job;
+    static void run(std::shared_ptr<Job> job);
+    bool copyBlocks(bool timed);
+    void writeSnapshot();
+    void complete();
+
+    std::shared_ptr<Job> job;
+    QTimer* sliceTimer;
+    QPointer<QTextDocument> snapshotDocument;  // Null unless a copy is under way
+    QTextBlock nextBlock;
+    QStringList snapshotBlocks;
+    QString snapshotPath;
+    const int frameBudgetMs = 8;
+};
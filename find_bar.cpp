@@ -0,0 +1,143 @@
+#include "find_bar.h"
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QToolButton>
+
+FindBar::FindBar(QWidget* parent)
+    : QWidget(parent)
+{
+    auto layout = new QVBoxLayout(this);
+    layout->setContentsMargins(8, 4, 8, 4);
+    layout->setSpacing(4);
+    
+    // Find row
+    auto findRow = new QWidget(this);
+    auto findLayout = new QHBoxLayout(findRow);
+    findLayout->setContentsMargins(0, 0, 0, 0);
+    
+    input = new QLineEdit;
+    input->setPlaceholderText(tr("Find"));
+    input->setFrame(false);
+    input->installEventFilter(this);
+    findLayout->addWidget(input);
+    
+    countLabel = new QLabel;
+    findLayout->addWidget(countLabel);
+    
+    caseButton = new QToolButton;
+    caseButton->setText(QStringLiteral("Aa"));
+    caseButton->setToolTip(tr("Match case"));
+    caseButton->setCheckable(true);
+    caseButton->setAutoRaise(true);
+    caseButton->setFocusPolicy(Qt::NoFocus);
+    findLayout->addWidget(caseButton);
+    
+    regexButton = new QToolButton;
+    regexButton->setText(QStringLiteral(".*"));
+    regexButton->setToolTip(tr("Regular expression"));
+    regexButton->setCheckable(true);
+    regexButton->setAutoRaise(true);
+    regexButton->setFocusPolicy(Qt::NoFocus);
+    findLayout->addWidget(regexButton);
+    layout->addWidget(findRow);
+    
+    // Replace row, only shown when opened for replacing
+    replaceRow = new QWidget(this);
+    auto replaceLayout = new QHBoxLayout(replaceRow);
+    replaceLayout->setContentsMargins(0, 0, 0, 0);
+    
+    replaceInput = new QLineEdit;
+    replaceInput->setPlaceholderText(tr("Replace"));
+    replaceInput->setFrame(false);
+    replaceInput->installEventFilter(this);
+    replaceLayout->addWidget(replaceInput);
+    
+    replaceAllButton = new QPushButton(tr("Replace All"));
+    replaceAllButton->setFocusPolicy(Qt::NoFocus);
+    replaceAllButton->setFlat(true);
+    replaceLayout->addWidget(replaceAllButton);
+    replaceRow->hide();
+    layout->addWidget(replaceRow);
+    
+    connect(input, &QLineEdit::textChanged, this, &FindBar::searchChanged);
+    connect(caseButton, &QToolButton::toggled, this, &FindBar::searchChanged);
+    connect(regexButton, &QToolButton::toggled, this, &FindBar::searchChanged);
+    connect(replaceAllButton, &QPushButton::clicked, this, &FindBar::replaceAll);
+    
+    setAutoFillBackground(true);
+    hide();
+}
+
+QString FindBar::text() const {
+    return input->text();
+}
+
+QString FindBar::replacement() const {
+    return replaceInput->text();
+}
+
+bool FindBar::isRegex() const {
+    return regexButton->isChecked();
+}
+
+Qt::CaseSensitivity FindBar::caseSensitivity() const {
+    return caseButton->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+}
+
+void FindBar::activate(const QString& text, bool replace) {
+    if (!text.isEmpty()) {
+        input->setText(text);
+    }
+    replaceRow->setVisible(replace);
+    show();
+    
+    // Replacing starts where the needle is already filled in
+    QLineEdit* focus = replace && !input->text().isEmpty() ? replaceInput : input;
+    focus->setFocus();
+    focus->selectAll();
+}
+
+void FindBar::setMatchCount(qsizetype current, qsizetype count) {
+    if (input->text().isEmpty()) {
+        countLabel->clear();
+    } else if (count == 0) {
+        countLabel->setText(tr("No matches"));
+    } else if (current < 0) {
+        countLabel->setText(count == 1 ? tr("1 match") : tr("%1 matches").arg(count));
+    } else {
+        countLabel->setText(tr("%1 of %2").arg(current + 1).arg(count));
+    }
+}
+
+void FindBar::showStatus(const QString& status) {
+    countLabel->setText(status);
+}
+
+bool FindBar::eventFilter(QObject* obj, QEvent* event) {
+    if ((obj == input || obj == replaceInput) && event->type() == QEvent::KeyPress) {
+        QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
+        switch (keyEvent->key()) {
+            case Qt::Key_Return:
+            case Qt::Key_Enter:
+                if (obj == replaceInput) {
+                    emit replaceAll();
+                } else if (keyEvent->modifiers() & Qt::ShiftModifier) {
+                    emit findPrevious();
+                } else {
+                    emit findNext();
+                }
+                return true;
+            case Qt::Key_Escape:
+                hide();
+                emit closed();
+                return true;
+            default:
+                break;
+        }
+    }
+    return QWidget::eventFilter(obj, event);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QWidget>
+
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QToolButton;
+
+// Incremental find bar shown below the editor, with an optional replace
+// row. It only collects input and shows results; EditorWindow runs the
+// search on each change and performs the replace.
+class FindBar : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit FindBar(QWidget* parent = nullptr);
+
+    QString text() const;
+    QString replacement() const;
+    Qt::CaseSensitivity caseSensitivity() const;
+    bool isRegex() const;
+    void activate(const QString& text = QString(), bool replace = false);
+    void setMatchCount(qsizetype current, qsizetype count);  // current is 0-based, -1 if none
+    void showStatus(const QString& status);
+
+signals:
+    void searchChanged();
+    void findNext();
+    void findPrevious();
+    void replaceAll();
+    void closed();
+
+protected:
+    bool eventFilter(QObject* obj, QEvent* event) override;
+
+private:
+    QLineEdit* input;
+    QToolButton* caseButton;
+    QToolButton* regexButton;
+    QLabel* countLabel;
+    QWidget* replaceRow;
+    QLineEdit* replaceInput;
+    QPushButton* replaceAllButton;
+};
@@ -0,0 +1,163 @@
+#include "indent_detector.h"
+#include "worker_job.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QThreadPool>
+#include <atomic>
+
+namespace {
+const qint64 windowSize = 64 * 1024;  // Bytes read per sample window
+const int windowCount = 4;            // Start of the file plus evenly spaced points after it
+const int maxWidth = 8;
+}
+
+struct IndentDetector::Job {
+    QString filePath;
+    std::atomic<bool> canceled{false};
+    QMutex mutex;
+    IndentDetector* receiver = nullptr;  // Cleared once the detector stops listening
+};
+
+IndentDetector::IndentDetector(QObject* parent)
+    : QObject(parent)
+{
+}
+
+IndentDetector::~IndentDetector() {
+    cancel();
+}
+
+QString IndentDetector::cacheKey(const QString& filePath) {
+    return QFileInfo(filePath).absoluteFilePath();
+}
+
+bool IndentDetector::cached(const QString& filePath, Style* style) const {
+    const auto it = cache.constFind(cacheKey(filePath));
+    if (it == cache.constEnd()) return false;
+    
+    *style = it.value();
+    return true;
+}
+
+void IndentDetector::start(const QString& filePath) {
+    cancel();
+    
+    job = std::make_shared<Job>();
+    job->filePath = filePath;
+    job->receiver = this;
+    
+    std::shared_ptr<Job> started = job;
+    QThreadPool::globalInstance()->start([started] { run(started); });
+}
+
+void IndentDetector::cancel() {
+    if (!job) return;
+    
+    job->canceled = true;
+    {
+        QMutexLocker locker(&job->mutex);
+        job->receiver = nullptr;
+    }
+    job.reset();
+}
+
+void IndentDetector::post(const std::shared_ptr<Job>& job, std::function<void(IndentDetector*)> fn) {
+    // Results of a job that has since been replaced are dropped on arrival;
+    // a delivered result ends the job
+    postJobResult(job, &IndentDetector::job, [fn = std::move(fn)](IndentDetector* detector) {
+        detector->job.reset();
+        fn(detector);
+    });
+}
+
+void IndentDetector::run(std::shared_ptr<Job> job) {
+    QFile file(job->filePath);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    
+    // Whole lines from each window; a window that starts mid-line drops
+    // its first partial line, and every window its last
+    const qint64 size = file.size();
+    QList<QByteArray> windows;
+    QList<QByteArrayView> lines;
+    qint64 covered = 0;
+    for (int i = 0; i < windowCount && !job->canceled; ++i) {
+        const qint64 offset = qMax(size / windowCount * i, covered);
+        if (offset >= size) break;  // Small file: read through already
+        
+        file.seek(offset);
+        windows.append(file.read(windowSize));
+        covered = offset + windows.last().size();
+        const QByteArray& data = windows.last();
+        qsizetype start = 0;
+        if (offset > 0) {
+            start = data.indexOf('\n') + 1;
+            if (start == 0) continue;
+        }
+        const bool complete = offset + data.size() >= size;
+        while (start < data.size()) {
+            qsizetype end = data.indexOf('\n', start);
+            if (end < 0) {
+                if (!complete) break;
+                end = data.size();
+            }
+            lines.append(QByteArrayView(data).sliced(start, end - start));
+            start = end + 1;
+        }
+    }
+    if (job->canceled) return;
+    
+    Style style;
+    if (!detect(lines, &style)) return;
+    
+    const QString filePath = job->filePath;
+    post(job, [filePath, style](IndentDetector* detector) {
+        detector->cache.insert(cacheKey(filePath), style);
+        emit detector->detected(filePath, style);
+    });
+}
+
+bool IndentDetector::detect(const QList<QByteArrayView>& lines, Style* style) {
+    // Tabs against spaces by the lines they start; the width by how much
+    // the indentation changes between neighbouring space-indented lines.
+    // Steps of one are mostly alignment (" * " in block comments), so
+    // they don't vote.
+    int tabLines = 0;
+    int spaceLines = 0;
+    int votes[maxWidth + 1] = {};
+    int previous = -1;
+    for (QByteArrayView line : lines) {
+        qsizetype indent = 0;
+        while (indent < line.size() && (line[indent] == ' ' || line[indent] == '\t')) {
+            ++indent;
+        }
+        if (indent == line.size() || (indent == line.size() - 1 && line[indent] == '\r')) continue;  // Blank
+        
+        if (line[0] == '\t') {
+            ++tabLines;
+            previous = -1;
+            continue;
+        }
+        if (indent > 0) {
+            ++spaceLines;
+        }
+        if (previous >= 0) {
+            const int step = qAbs(int(indent) - previous);
+            if (step >= 2 && step <= maxWidth) {
+                ++votes[step];
+            }
+        }
+        previous = int(indent);
+    }
+    if (tabLines == 0 && spaceLines == 0) return false;
+    
+    style->tabs = tabLines > spaceLines;
+    int best = 0;
+    for (int width = 2; width <= maxWidth; ++width) {
+        if (votes[width] > votes[best]) {
+            best = width;
+        }
+    }
+    style->width = best > 0 ? best : 4;
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QByteArrayView>
+#include <QList>
+#include <functional>
+#include <memory>
+
+// Works out whether a file is indented with tabs or spaces, and how many
+// spaces make a level, from a bounded sample of its lines read on a
+// worker thread. Only a few windows spread through the file are read, so
+// the cost doesn't grow with the file. Results are kept per path for the
+// rest of the session.
+class IndentDetector : public QObject {
+    Q_OBJECT
+
+public:
+    struct Style {
+        bool tabs = false;
+        int width = 4;
+    };
+
+    explicit IndentDetector(QObject* parent = nullptr);
+    ~IndentDetector();
+
+    // A path detected earlier in the session is answered from the cache
+    bool cached(const QString& filePath, Style* style) const;
+    void start(const QString& filePath);
+    void cancel();
+
+    // Style of a sample; false when no line in it is indented
+    static bool detect(const QList<QByteArrayView>& lines, Style* style);
+
+signals:
+    void detected(const QString& filePath, const IndentDetector::Style& style);
+
+private:
+    struct Job;
+    static void run(std::shared_ptr<Job> job);
+    static void post(const std::shared_ptr<Job>& job, std::function<void(IndentDetector*)> fn);
+    static QString cacheKey(const QString& filePath);
+
+    std::shared_ptr<Job> job;
+    QHash<QString, Style> cache;
+};
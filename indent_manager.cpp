@@ -1,4 +1,6 @@
 #include "indent_manager.h"
+#include "latency_monitor.h"
+#include "undo_history.h"
 #include <QTextCursor>
 #include <QTextBlock>
 #include <QDebug>
@@ -7,94 +9,261 @@ IndentManager::IndentManager(CustomEditor* editor, QObject* parent)
     : QObject(parent)
     , editor(editor)
     , language(Language::None)
+    , useTabs(false)
+    , indentWidth(4)
 {
     editor->installEventFilter(this);
+    
+    rebuildIndentLengths();
+    connect(editor->document(), &QTextDocument::contentsChange,
+            this, &IndentManager::handleContentsChange);
 }
 
 void IndentManager::setLanguage(Language lang) {
     language = lang;
 }
 
+void IndentManager::setIndentStyle(bool tabs, int width) {
+    useTabs = tabs;
+    indentWidth = width;
+}
+
+void IndentManager::handleContentsChange(int position, int charsRemoved, int charsAdded) {
+    Q_UNUSED(charsRemoved);
+    QTextDocument* document = editor->document();
+    const int delta = document->blockCount() - indentLengths.size();
+    
+    // Blocks touched by the change, numbered in the new document
+    QTextBlock first = document->findBlock(position);
+    QTextBlock last = document->findBlock(position + charsAdded);
+    if (!first.isValid()) first = document->lastBlock();
+    if (!last.isValid()) last = document->lastBlock();
+    
+    const int firstNumber = first.blockNumber();
+    const int newSpan = last.blockNumber() - firstNumber + 1;
+    const int oldSpan = newSpan - delta;
+    if (oldSpan < 0 || firstNumber + oldSpan > indentLengths.size()) {
+        rebuildIndentLengths();
+        return;
+    }
+    
+    if (delta > 0) {
+        indentLengths.insert(firstNumber + oldSpan, delta, 0);
+    } else if (delta < 0) {
+        indentLengths.remove(firstNumber + newSpan, -delta);
+    }
+    QTextBlock block = first;
+    for (int i = firstNumber; i < firstNumber + newSpan; ++i, block = block.next()) {
+        indentLengths[i] = measureIndent(block.text());
+    }
+}
+
+void IndentManager::rebuildIndentLengths() {
+    QTextDocument* document = editor->document();
+    indentLengths.resize(document->blockCount());
+    int i = 0;
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next(), ++i) {
+        indentLengths[i] = measureIndent(block.text());
+    }
+}
+
+int IndentManager::measureIndent(const QString& line) {
+    int length = 0;
+    while (length < line.size() && (line[length] == QLatin1Char(' ') || line[length] == QLatin1Char('\t'))) {
+        ++length;
+    }
+    return length;
+}
+
+int IndentManager::indentLength(const QTextBlock& block) const {
+    const int number = block.blockNumber();
+    return number < indentLengths.size() ? indentLengths[number] : measureIndent(block.text());
+}
+
+QString IndentManager::indentUnit() const {
+    return useTabs ? QStringLiteral("\t") : QString(indentWidth, QLatin1Char(' '));
+}
+
 bool IndentManager::eventFilter(QObject* obj, QEvent* event) {
     if (obj == editor && event->type() == QEvent::KeyPress) {
+        LatencyMonitor::Scope scope(LatencyMonitor::Filter);
         QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
-        handleKeyPress(keyEvent);
-        return false;  // Always let the editor handle the event too
+        return handleKeyPress(keyEvent);  // Keys handled here don't reach the editor
     }
     return false;
 }
 
-void IndentManager::handleKeyPress(QKeyEvent* event) {
+bool IndentManager::handleKeyPress(QKeyEvent* event) {
+    if (editor->isReadOnly()) return false;
+    
     switch (event->key()) {
         case Qt::Key_Return:
         case Qt::Key_Enter:
-            handleReturn();
-            break;
+            return handleReturn();
         case Qt::Key_Tab:
+            if (event->modifiers() & (Qt::ControlModifier | Qt::AltModifier | Qt::MetaModifier)) return false;
             handleTab();
-            break;
+            return true;
+        case Qt::Key_Backtab:
+            handleBacktab();
+            return true;
         case Qt::Key_Backspace:
-            handleBackspace();
-            break;
+            return event->modifiers() == Qt::NoModifier && handleBackspace();
         default:
-            break;
+            return false;
     }
 }
 
-void IndentManager::handleReturn() {
-    if (language == Language::None) return;
+bool IndentManager::handleReturn() {
+    if (language == Language::None) return false;
     
+    editor->prepareEdit();
     QTextCursor cursor = editor->textCursor();
     QString currentIndent = getCurrentIndentation();
     
     if (shouldIncreaseIndent()) {
-        currentIndent += QString(getIndentationWidth(), ' ');
+        currentIndent += indentUnit();
     }
     
     // Insert new line with indentation
     cursor.insertText("\n" + currentIndent);
     editor->setTextCursor(cursor);
+    return true;
 }
 
 void IndentManager::handleTab() {
     QTextCursor cursor = editor->textCursor();
-    cursor.insertText(QString(getIndentationWidth(), ' '));
+    if (cursor.hasSelection() && cursor.document()->findBlock(cursor.selectionStart()) != cursor.document()->findBlock(cursor.selectionEnd())) {
+        shiftLines(cursor, false);
+        return;
+    }
+    
+    // A tab, or spaces up to the next indentation stop
+    editor->prepareEdit();
+    const int width = getIndentationWidth();
+    const int column = cursor.selectionStart() - cursor.block().position();
+    cursor.insertText(useTabs ? indentUnit() : QString(width - column % width, ' '));
+    editor->setTextCursor(cursor);
+}
+
+void IndentManager::handleBacktab() {
+    shiftLines(editor->textCursor(), true);
 }
 
-void IndentManager::handleBackspace() {
+bool IndentManager::handleBackspace() {
     QTextCursor cursor = editor->textCursor();
-    QString currentLine = cursor.block().text();
+    if (cursor.hasSelection()) return false;
+    
     int column = cursor.columnNumber();
     
-    // Check if we're at the start of a line with only spaces
-    if (column > 0 && currentLine.left(column).trimmed().isEmpty()) {
+    // Check if we're within the line's indentation, and it is spaces
+    if (column > 0 && column <= indentLength(cursor.block())
+        && cursor.block().text().at(column - 1) == QLatin1Char(' ')) {
         int spaces = getIndentationWidth();
         int spacesToRemove = column % spaces;
         if (spacesToRemove == 0) spacesToRemove = spaces;
         
+        editor->prepareEdit();
         cursor.movePosition(QTextCursor::Left, QTextCursor::KeepAnchor, spacesToRemove);
         cursor.removeSelectedText();
+        return true;
     }
+    return false;
 }
 
-QString IndentManager::getCurrentIndentation() {
-    QTextCursor cursor = editor->textCursor();
-    QString line = cursor.block().text();
-    QString indent;
-    
-    for (QChar ch : line) {
-        if (ch.isSpace()) {
-            indent += ch;
-        } else {
-            break;
+void IndentManager::shiftLines(const QTextCursor& selection, bool outdent) {
+    QTextDocument* document = editor->document();
+    const QTextBlock first = document->findBlock(selection.selectionStart());
+    QTextBlock last = document->findBlock(selection.selectionEnd());
+    
+    // A selection ending at the start of a line leaves that line alone
+    if (last != first && selection.selectionEnd() == last.position()) {
+        last = last.previous();
+    }
+    
+    const int lineCount = last.blockNumber() - first.blockNumber() + 1;
+    const QString unit = indentUnit();
+    const int width = getIndentationWidth();
+    const int start = first.position();
+    const int end = last.position() + last.length() - 1;
+    
+    // Build the shifted lines as one string, mapping the selection's ends
+    // onto it along the way, so the document takes a single replacement
+    // however many lines there are
+    QString text;
+    text.reserve(end - start + (outdent ? 0 : lineCount * unit.size()));
+    const int anchor = selection.anchor();
+    const int position = selection.position();
+    int newAnchor = anchor;
+    int newPosition = position;
+    bool changed = false;
+    for (QTextBlock block = first; block.isValid(); block = block.next()) {
+        const QString line = block.text();
+        const int lineStart = block.position();
+        const int newLineStart = start + int(text.size());
+        
+        // One level: a tab or up to a unit's worth of spaces
+        int removed = 0;
+        int added = 0;
+        if (outdent) {
+            if (line.startsWith(QLatin1Char('\t'))) {
+                removed = 1;
+            } else {
+                while (removed < width && removed < line.size() && line[removed] == QLatin1Char(' ')) {
+                    ++removed;
+                }
+            }
+        } else if (!line.isEmpty()) {
+            text += unit;
+            added = unit.size();
         }
+        text += QStringView(line).mid(removed);
+        changed = changed || removed > 0 || added > 0;
+        
+        // Ends on this line keep their place in its text; an end at the
+        // start of the line stays there so the new indentation is selected
+        const auto map = [&](int pos) {
+            const int column = pos - lineStart;
+            return newLineStart + (column == 0 ? 0 : qMax(0, column - removed) + added);
+        };
+        if (anchor >= lineStart && anchor <= lineStart + line.size()) newAnchor = map(anchor);
+        if (position >= lineStart && position <= lineStart + line.size()) newPosition = map(position);
+        
+        if (block == last) break;
+        text += QLatin1Char('\n');
+    }
+    if (!changed) return;
+    
+    // Lines past the selection keep their offsets relative to its end
+    const int delta = int(text.size()) - (end - start);
+    if (anchor > end) newAnchor = anchor + delta;
+    if (position > end) newPosition = position + delta;
+    
+    if (lineCount >= lazyHighlightLines) {
+        emit largeEditStarting(start);
     }
     
-    return indent;
+    // One edit block: one undo step and one contentsChange
+    editor->undoHistory()->capture(start, end);
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    cursor.setPosition(start);
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
+    cursor.insertText(text);
+    cursor.endEditBlock();
+    
+    cursor.setPosition(newAnchor);
+    cursor.setPosition(newPosition, QTextCursor::KeepAnchor);
+    editor->setTextCursor(cursor);
+}
+
+QString IndentManager::getCurrentIndentation() {
+    const QTextBlock block = editor->textCursor().block();
+    return block.text().left(indentLength(block));
 }
 
 int IndentManager::getIndentationWidth() {
-    return 4;  // Fixed 4-space indentation
+    return indentWidth;  // Detected per file, 4 until known
 }
 
 bool IndentManager::shouldIncreaseIndent() {
@@ -3,8 +3,13 @@
 #include <QObject>
 #include <QTextEdit>
 #include <QKeyEvent>
+#include <QVector>
 #include "custom_editor.h"
 
+// Auto-indent on Return, indent-aware Tab and Backspace, and indenting
+// or outdenting every line of a selection as a single edit. The length
+// of each block's leading whitespace is kept up to date as the document
+// changes, so Return doesn't rescan the line.
 class IndentManager : public QObject {
     Q_OBJECT
 
@@ -17,19 +22,38 @@ public:
 
     explicit IndentManager(CustomEditor* editor, QObject* parent = nullptr);
     void setLanguage(Language lang);
+    void setIndentStyle(bool tabs, int width);
+
+signals:
+    // Sent before a selection of many lines is shifted, so highlighting
+    // from 'position' on can be left to a lazy pass
+    void largeEditStarting(int position);
 
 protected:
     bool eventFilter(QObject* obj, QEvent* event) override;
 
+private slots:
+    void handleContentsChange(int position, int charsRemoved, int charsAdded);
+
 private:
-    void handleKeyPress(QKeyEvent* event);
-    void handleReturn();
+    bool handleKeyPress(QKeyEvent* event);
+    bool handleReturn();
     void handleTab();
-    void handleBackspace();
+    void handleBacktab();
+    bool handleBackspace();
+    void shiftLines(const QTextCursor& selection, bool outdent);
     QString getCurrentIndentation();
     int getIndentationWidth();
+    QString indentUnit() const;
+    int indentLength(const QTextBlock& block) const;
+    static int measureIndent(const QString& line);
+    void rebuildIndentLengths();
     bool shouldIncreaseIndent();
 
     CustomEditor* editor;
     Language language;
+    bool useTabs;
+    int indentWidth;
+    QVector<int> indentLengths;  // Leading spaces and tabs of each block
+    const int lazyHighlightLines = 64;  // Shifts of more lines highlight lazily
 };
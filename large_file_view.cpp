@@ -0,0 +1,395 @@
+#include "large_file_view.h"
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <climits>
+
+namespace {
+const qint64 maxLineBytes = 4 * 1024 * 1024;  // Longer lines are shown and edited truncated
+
+// Visual column of a character position, with tabs expanded
+int visualColumn(const QString& text, int column, int tabWidth) {
+    int visual = 0;
+    for (int i = 0; i < column && i < text.size(); ++i) {
+        visual += text.at(i) == QLatin1Char('\t') ? tabWidth - visual % tabWidth : 1;
+    }
+    return visual;
+}
+
+QString expandTabs(const QString& text, int tabWidth) {
+    if (!text.contains(QLatin1Char('\t'))) return text;
+
+    QString expanded;
+    expanded.reserve(text.size() + tabWidth * 4);
+    for (QChar ch : text) {
+        if (ch == QLatin1Char('\t')) {
+            expanded.append(QString(tabWidth - expanded.size() % tabWidth, QLatin1Char(' ')));
+        } else {
+            expanded.append(ch);
+        }
+    }
+    return expanded;
+}
+}
+
+LargeFileView::LargeFileView(QWidget* parent)
+    : QAbstractScrollArea(parent)
+    , cursorLine(0)
+    , cursorColumn(0)
+    , widestLine(0)
+    , modified(false)
+    , readOnly(false)
+{
+    setFrameStyle(0);
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setCursor(Qt::IBeamCursor);
+}
+
+bool LargeFileView::open(const QString& filePath, QString* error) {
+    if (!table.open(filePath, error)) return false;
+
+    cursorLine = 0;
+    cursorColumn = 0;
+    widestLine = 0;
+    setModified(false);
+    updateScrollBars();
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+    viewport()->update();
+    return true;
+}
+
+bool LargeFileView::reopen(const QString& filePath, QString* error) {
+    const qint64 line = cursorLine;
+    const int column = cursorColumn;
+    const int firstLine = verticalScrollBar()->value();
+    const int scrollX = horizontalScrollBar()->value();
+
+    if (!open(filePath, error)) return false;
+
+    verticalScrollBar()->setValue(firstLine);
+    horizontalScrollBar()->setValue(scrollX);
+    moveCursor(line, column);
+    return true;
+}
+
+void LargeFileView::close() {
+    table.close();
+    cursorLine = 0;
+    cursorColumn = 0;
+    widestLine = 0;
+    setModified(false);
+}
+
+QString LargeFileView::lineText(qint64 line) const {
+    const qint64 start = table.lineStart(line);
+    const qint64 length = qMin(table.lineEnd(line) - start, maxLineBytes);
+    QString text = QString::fromUtf8(table.text(start, length));
+
+    // A \r\n line break is handled as a unit; the \r is never shown
+    if (text.endsWith(QLatin1Char('\r'))) {
+        text.chop(1);
+    }
+    return text;
+}
+
+qint64 LargeFileView::cursorOffset() const {
+    return table.lineStart(cursorLine) + lineText(cursorLine).left(cursorColumn).toUtf8().size();
+}
+
+int LargeFileView::gutterWidth() const {
+    int digits = 1;
+    for (qint64 max = table.lineCount(); max >= 10; max /= 10) {
+        ++digits;
+    }
+    return fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits + textMargin;
+}
+
+int LargeFileView::visibleLineCount() const {
+    return qMax(1, viewport()->height() / fontMetrics().height());
+}
+
+int LargeFileView::columnAt(const QString& text, int x) const {
+    const int charWidth = qMax(1, fontMetrics().horizontalAdvance(QLatin1Char(' ')));
+    const int target = (x + charWidth / 2) / charWidth;
+
+    int visual = 0;
+    for (int i = 0; i < text.size(); ++i) {
+        if (visual >= target) return i;
+        visual += text.at(i) == QLatin1Char('\t') ? tabWidth - visual % tabWidth : 1;
+    }
+    return text.size();
+}
+
+void LargeFileView::paintEvent(QPaintEvent* event) {
+    QPainter painter(viewport());
+    const QPalette pal = palette();
+    painter.fillRect(event->rect(), pal.color(QPalette::Base));
+    painter.setFont(font());
+
+    const QFontMetrics metrics(font());
+    const int lineHeight = metrics.height();
+    const int charWidth = metrics.horizontalAdvance(QLatin1Char(' '));
+    const int gutter = gutterWidth();
+    const int textLeft = gutter + textMargin / 2 - horizontalScrollBar()->value();
+    const QRect textArea(gutter, 0, viewport()->width() - gutter, viewport()->height());
+    const qint64 firstLine = verticalScrollBar()->value();
+
+    QColor numberColor = pal.color(QPalette::Text);
+    numberColor.setAlphaF(0.4);
+
+    // Only lines inside the exposed rect are fetched, decoded and drawn
+    int widest = widestLine;
+    for (int row = event->rect().top() / lineHeight; row * lineHeight <= event->rect().bottom(); ++row) {
+        const qint64 line = firstLine + row;
+        if (line >= table.lineCount()) break;
+
+        const int top = row * lineHeight;
+        const QString text = lineText(line);
+        const QString expanded = expandTabs(text, tabWidth);
+        widest = qMax(widest, int(expanded.size()) * charWidth);
+
+        painter.setClipRect(textArea);
+        painter.setPen(pal.color(QPalette::Text));
+        painter.drawText(textLeft, top + metrics.ascent(), expanded);
+
+        if (line == cursorLine) {
+            const int x = textLeft + visualColumn(text, cursorColumn, tabWidth) * charWidth;
+            painter.fillRect(x, top, 1, lineHeight, pal.color(QPalette::Text));
+        }
+
+        painter.setClipping(false);
+        painter.setPen(numberColor);
+        painter.drawText(QRect(0, top, gutter - textMargin / 2, lineHeight),
+                         Qt::AlignRight | Qt::AlignVCenter, QString::number(line + 1));
+    }
+
+    // Horizontal extent is only known for lines seen so far
+    if (widest > widestLine) {
+        widestLine = widest;
+        QMetaObject::invokeMethod(this, [this] { updateScrollBars(); }, Qt::QueuedConnection);
+    }
+}
+
+void LargeFileView::resizeEvent(QResizeEvent* event) {
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void LargeFileView::changeEvent(QEvent* event) {
+    QAbstractScrollArea::changeEvent(event);
+    if (event->type() == QEvent::FontChange) {
+        widestLine = 0;
+        updateScrollBars();
+        viewport()->update();
+    }
+}
+
+void LargeFileView::scrollContentsBy(int dx, int dy) {
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+    viewport()->update();
+}
+
+void LargeFileView::updateScrollBars() {
+    const int lines = visibleLineCount();
+    const qint64 lastFirstLine = qMax<qint64>(0, table.lineCount() - lines);
+    verticalScrollBar()->setRange(0, int(qMin<qint64>(lastFirstLine, INT_MAX)));
+    verticalScrollBar()->setPageStep(lines);
+    verticalScrollBar()->setSingleStep(1);
+
+    const int textWidth = viewport()->width() - gutterWidth() - textMargin;
+    horizontalScrollBar()->setRange(0, qMax(0, widestLine - textWidth));
+    horizontalScrollBar()->setPageStep(qMax(1, textWidth));
+    horizontalScrollBar()->setSingleStep(fontMetrics().horizontalAdvance(QLatin1Char(' ')));
+}
+
+void LargeFileView::ensureCursorVisible() {
+    const int lines = visibleLineCount();
+    QScrollBar* vertical = verticalScrollBar();
+    if (cursorLine < vertical->value()) {
+        vertical->setValue(int(cursorLine));
+    } else if (cursorLine >= vertical->value() + lines) {
+        vertical->setValue(int(cursorLine - lines + 1));
+    }
+
+    const int charWidth = fontMetrics().horizontalAdvance(QLatin1Char(' '));
+    const QString text = lineText(cursorLine);
+    const int x = visualColumn(text, cursorColumn, tabWidth) * charWidth;
+    widestLine = qMax(widestLine, visualColumn(text, text.size(), tabWidth) * charWidth);
+    updateScrollBars();
+
+    const int textWidth = viewport()->width() - gutterWidth() - textMargin;
+    QScrollBar* horizontal = horizontalScrollBar();
+    if (x < horizontal->value()) {
+        horizontal->setValue(x);
+    } else if (x > horizontal->value() + textWidth - charWidth) {
+        horizontal->setValue(x - textWidth + charWidth);
+    }
+}
+
+void LargeFileView::moveCursor(qint64 line, int column) {
+    cursorLine = qBound<qint64>(0, line, table.lineCount() - 1);
+    const QString text = lineText(cursorLine);
+    cursorColumn = qBound(0, column, int(text.size()));
+    if (cursorColumn > 0 && cursorColumn < text.size() && text.at(cursorColumn).isLowSurrogate()) {
+        --cursorColumn;
+    }
+
+    ensureCursorVisible();
+    viewport()->update();
+}
+
+void LargeFileView::setModified(bool modified) {
+    if (this->modified == modified) return;
+
+    this->modified = modified;
+    emit modificationChanged(modified);
+}
+
+void LargeFileView::insertText(const QString& text) {
+    if (readOnly) return;
+
+    table.insert(cursorOffset(), text.toUtf8());
+
+    const int newlines = text.count(QLatin1Char('\n'));
+    if (newlines > 0) {
+        cursorLine += newlines;
+        cursorColumn = text.size() - text.lastIndexOf(QLatin1Char('\n')) - 1;
+    } else {
+        cursorColumn += text.size();
+    }
+
+    setModified(true);
+    ensureCursorVisible();
+    viewport()->update();
+}
+
+void LargeFileView::removeBackward() {
+    if (readOnly) return;
+
+    const qint64 offset = cursorOffset();
+    if (cursorColumn > 0) {
+        const QString text = lineText(cursorLine);
+        int from = cursorColumn - 1;
+        if (from > 0 && text.at(from).isLowSurrogate()) {
+            --from;
+        }
+        const qint64 start = table.lineStart(cursorLine) + text.left(from).toUtf8().size();
+        table.remove(start, offset - start);
+        cursorColumn = from;
+    } else if (cursorLine > 0) {
+        // Join with the previous line, taking a \r\n pair along as one break
+        const int previousLength = lineText(cursorLine - 1).size();
+        qint64 start = table.lineEnd(cursorLine - 1);
+        if (start > 0 && table.text(start - 1, 1) == "\r") {
+            --start;
+        }
+        table.remove(start, offset - start);
+        --cursorLine;
+        cursorColumn = previousLength;
+    } else {
+        return;
+    }
+
+    setModified(true);
+    updateScrollBars();
+    ensureCursorVisible();
+    viewport()->update();
+}
+
+void LargeFileView::removeForward() {
+    if (readOnly) return;
+
+    const QString text = lineText(cursorLine);
+    const qint64 offset = cursorOffset();
+    qint64 end;
+    if (cursorColumn < text.size()) {
+        int to = cursorColumn + 1;
+        if (to < text.size() && text.at(to).isLowSurrogate()) {
+            ++to;
+        }
+        end = table.lineStart(cursorLine) + text.left(to).toUtf8().size();
+    } else if (cursorLine < table.lineCount() - 1) {
+        end = table.lineStart(cursorLine + 1);  // Includes a \r before the \n
+    } else {
+        return;
+    }
+    table.remove(offset, end - offset);
+
+    setModified(true);
+    updateScrollBars();
+    viewport()->update();
+}
+
+void LargeFileView::keyPressEvent(QKeyEvent* event) {
+    const bool ctrl = event->modifiers().testFlag(Qt::ControlModifier);
+    const QString text = lineText(cursorLine);
+
+    switch (event->key()) {
+        case Qt::Key_Left:
+            if (cursorColumn > 0) {
+                int column = cursorColumn - 1;
+                if (column > 0 && text.at(column).isLowSurrogate()) --column;
+                moveCursor(cursorLine, column);
+            } else if (cursorLine > 0) {
+                moveCursor(cursorLine - 1, INT_MAX);
+            }
+            return;
+        case Qt::Key_Right:
+            if (cursorColumn < text.size()) {
+                moveCursor(cursorLine, cursorColumn + 1 + (cursorColumn + 1 < text.size()
+                                                          && text.at(cursorColumn + 1).isLowSurrogate()));
+            } else if (cursorLine < table.lineCount() - 1) {
+                moveCursor(cursorLine + 1, 0);
+            }
+            return;
+        case Qt::Key_Up:
+            moveCursor(cursorLine - 1, cursorColumn);
+            return;
+        case Qt::Key_Down:
+            moveCursor(cursorLine + 1, cursorColumn);
+            return;
+        case Qt::Key_PageUp:
+            moveCursor(cursorLine - visibleLineCount(), cursorColumn);
+            return;
+        case Qt::Key_PageDown:
+            moveCursor(cursorLine + visibleLineCount(), cursorColumn);
+            return;
+        case Qt::Key_Home:
+            moveCursor(ctrl ? 0 : cursorLine, 0);
+            return;
+        case Qt::Key_End:
+            moveCursor(ctrl ? table.lineCount() - 1 : cursorLine, INT_MAX);
+            return;
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            insertText(QStringLiteral("\n"));
+            return;
+        case Qt::Key_Backspace:
+            removeBackward();
+            return;
+        case Qt::Key_Delete:
+            removeForward();
+            return;
+        case Qt::Key_Tab:
+            insertText(QString(tabWidth, QLatin1Char(' ')));
+            return;
+        default:
+            break;
+    }
+
+    if (!ctrl && !event->text().isEmpty() && event->text().at(0).isPrint()) {
+        insertText(event->text());
+        return;
+    }
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void LargeFileView::mousePressEvent(QMouseEvent* event) {
+    const qint64 line = qBound<qint64>(0, verticalScrollBar()->value() + int(event->position().y()) / fontMetrics().height(),
+                                       table.lineCount() - 1);
+    const int x = int(event->position().x()) - gutterWidth() - textMargin / 2 + horizontalScrollBar()->value();
+    moveCursor(line, columnAt(lineText(line), x));
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QAbstractScrollArea>
+#include <QString>
+#include "file_saver.h"
+#include "piece_table.h"
+
+// Editor view for files too large for QTextDocument. Text lives in a
+// PieceTable and only the lines inside the viewport are decoded and drawn,
+// so memory use doesn't grow with the file. Editing is cursor based
+// (no selection or undo) and the content is treated as UTF-8.
+class LargeFileView : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+    explicit LargeFileView(QWidget* parent = nullptr);
+
+    bool open(const QString& filePath, QString* error = nullptr);
+    bool reopen(const QString& filePath, QString* error = nullptr);
+    void close();
+
+    bool isModified() const { return modified; }
+    void setReadOnly(bool readOnly) { this->readOnly = readOnly; }
+    FileSaver::Writer writer() const { return table.writer(); }
+    void goToLine(qint64 line) { moveCursor(line, 0); }
+
+signals:
+    void modificationChanged(bool modified);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void keyPressEvent(QKeyEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void changeEvent(QEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private:
+    QString lineText(qint64 line) const;
+    qint64 cursorOffset() const;
+    int gutterWidth() const;
+    int visibleLineCount() const;
+    int columnAt(const QString& text, int x) const;
+    void insertText(const QString& text);
+    void removeBackward();
+    void removeForward();
+    void moveCursor(qint64 line, int column);
+    void setModified(bool modified);
+    void updateScrollBars();
+    void ensureCursorVisible();
+
+    PieceTable table;
+    qint64 cursorLine;
+    int cursorColumn;  // In QChar units of the decoded line
+    int widestLine;    // Widest line painted so far, in pixels
+    bool modified;
+    bool readOnly;
+    const int textMargin = 20;
+    const int tabWidth = 4;
+};
@@ -0,0 +1,128 @@
+#include "latency_monitor.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+
+LatencyMonitor::Scope::Scope(Stage stage)
+    : stage(stage)
+    , start(-1)
+{
+    LatencyMonitor& monitor = LatencyMonitor::instance();
+    if (monitor.inputPending()) {
+        start = monitor.now();
+    }
+}
+
+LatencyMonitor::Scope::~Scope() {
+    if (start < 0) return;
+    
+    LatencyMonitor& monitor = LatencyMonitor::instance();
+    monitor.record(stage, start, monitor.now() - start);
+}
+
+LatencyMonitor::LatencyMonitor()
+    : written(0)
+    , inputCount(0)
+    , inputStart(-1)
+{
+    clock.start();
+}
+
+LatencyMonitor& LatencyMonitor::instance() {
+    static LatencyMonitor monitor;
+    return monitor;
+}
+
+void LatencyMonitor::beginInput() {
+    // Keys that arrive before a paint are counted from the first one
+    if (inputStart < 0) {
+        inputStart = now();
+        ++inputCount;
+    }
+}
+
+void LatencyMonitor::endInput() {
+    if (inputStart < 0) return;
+    
+    record(Input, inputStart, now() - inputStart);
+    inputStart = -1;
+}
+
+void LatencyMonitor::record(Stage stage, qint64 start, qint64 duration) {
+    if (!inputPending()) return;
+    
+    // Single producer: claim the slot, fill it, then publish it
+    const quint64 index = written.load(std::memory_order_relaxed);
+    ring[index % capacity] = {start, duration, inputCount, stage};
+    written.store(index + 1, std::memory_order_release);
+}
+
+QVector<LatencyMonitor::Event> LatencyMonitor::events() const {
+    const quint64 end = written.load(std::memory_order_acquire);
+    const quint64 begin = end > quint64(capacity) ? end - capacity : 0;
+    
+    QVector<Event> result;
+    result.reserve(int(end - begin));
+    for (quint64 i = begin; i < end; ++i) {
+        result.append(ring[i % capacity]);
+    }
+    
+    // Drop whatever the writer may have overwritten while we were copying
+    const quint64 after = written.load(std::memory_order_acquire);
+    const quint64 overwritten = after > quint64(capacity) ? after - capacity : 0;
+    if (overwritten > begin) {
+        result.remove(0, int(qMin<quint64>(overwritten - begin, result.size())));
+    }
+    return result;
+}
+
+LatencyMonitor::Percentiles LatencyMonitor::percentiles(const QVector<Event>& events, Stage stage) {
+    QVector<qint64> durations;
+    for (const Event& event : events) {
+        if (event.stage == stage) {
+            durations.append(event.duration);
+        }
+    }
+    if (durations.isEmpty()) return {0, 0, 0};
+    
+    std::sort(durations.begin(), durations.end());
+    return {durations[durations.size() / 2], durations[durations.size() * 99 / 100], int(durations.size())};
+}
+
+const char* LatencyMonitor::stageName(Stage stage) {
+    switch (stage) {
+        case Input: return "input";
+        case Filter: return "filter";
+        case Edit: return "edit";
+        case Highlight: return "highlight";
+        case Layout: return "layout";
+        case Paint: return "paint";
+        default: return "unknown";
+    }
+}
+
+QByteArray LatencyMonitor::chromeTrace() const {
+    // Complete ("X") events in the Chrome trace event format, in microseconds
+    QJsonArray traceEvents;
+    for (const Event& event : events()) {
+        QJsonObject object{
+            {QStringLiteral("name"), QLatin1String(stageName(event.stage))},
+            {QStringLiteral("cat"), QStringLiteral("editor")},
+            {QStringLiteral("ph"), QStringLiteral("X")},
+            {QStringLiteral("ts"), event.start / 1000.0},
+            {QStringLiteral("dur"), event.duration / 1000.0},
+            {QStringLiteral("pid"), 1},
+            {QStringLiteral("tid"), event.stage == Input ? 2 : 1}
+        };
+        if (event.input) {
+            object.insert(QStringLiteral("args"), QJsonObject{{QStringLiteral("input"), qint64(event.input)}});
+        }
+        traceEvents.append(object);
+    }
+    
+    return QJsonDocument(QJsonObject{
+        {QStringLiteral("traceEvents"), traceEvents},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")}
+    }).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QVector>
+#include <atomic>
+
+// Records how long each stage of handling input takes, from the key press
+// through event filters, the document edit, highlighting and layout to the
+// next viewport paint. Only work done on behalf of a pending input is
+// recorded, so idle work like background highlighting doesn't crowd out
+// the keystrokes. Events go into a fixed-size lock-free ring buffer
+// written from the GUI thread; readers copy it out without blocking it.
+class LatencyMonitor {
+public:
+    enum Stage : quint8 {
+        Input,      // Key press to the end of the next viewport paint
+        Filter,
+        Edit,
+        Highlight,
+        Layout,
+        Paint,
+        StageCount
+    };
+
+    struct Event {
+        qint64 start;     // Nanoseconds since the monitor was created
+        qint64 duration;
+        quint32 input;    // Input the event belongs to, 0 if none
+        Stage stage;
+    };
+
+    struct Percentiles {
+        qint64 p50;
+        qint64 p99;
+        int count;
+    };
+
+    // Times the enclosing scope as one stage of the pending input, if any
+    class Scope {
+    public:
+        explicit Scope(Stage stage);
+        ~Scope();
+
+    private:
+        Stage stage;
+        qint64 start;
+    };
+
+    static LatencyMonitor& instance();
+
+    qint64 now() const { return clock.nsecsElapsed(); }
+    bool inputPending() const { return inputStart >= 0; }
+    void beginInput();
+    void endInput();
+    void record(Stage stage, qint64 start, qint64 duration);
+
+    QVector<Event> events() const;  // Oldest first
+    static Percentiles percentiles(const QVector<Event>& events, Stage stage);
+    QByteArray chromeTrace() const;
+    static const char* stageName(Stage stage);
+
+private:
+    LatencyMonitor();
+
+    static const int capacity = 1 << 16;
+
+    Event ring[capacity];
+    std::atomic<quint64> written;
+    QElapsedTimer clock;
+    quint32 inputCount;
+    qint64 inputStart;  // -1 while no input is waiting for its paint
+};
@@ -0,0 +1,95 @@
+#include "latency_overlay.h"
+#include "latency_monitor.h"
+#include "undo_history.h"
+#include <QEvent>
+#include <QPainter>
+#include <QTimer>
+
+LatencyOverlay::LatencyOverlay(QWidget* parent)
+    : QWidget(parent)
+    , undoHistory(nullptr)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    
+    QFont overlayFont = font();
+    overlayFont.setStyleHint(QFont::Monospace);
+    overlayFont.setFamily(QStringLiteral("Menlo"));
+    overlayFont.setPointSize(10);
+    setFont(overlayFont);
+    
+    // Fixed size: one line per stage plus a header and the undo memory
+    const QFontMetrics metrics(overlayFont);
+    resize(metrics.horizontalAdvance(QStringLiteral("highlight  999.99  999.99 ms")) + 2 * padding,
+           metrics.height() * (LatencyMonitor::StageCount + 2) + 2 * padding);
+    
+    refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(refreshMs);
+    connect(refreshTimer, &QTimer::timeout, this, qOverload<>(&QWidget::update));
+    
+    parent->installEventFilter(this);
+    hide();
+}
+
+void LatencyOverlay::setUndoHistory(const UndoHistory* history) {
+    undoHistory = history;
+    update();
+}
+
+void LatencyOverlay::toggle() {
+    if (isVisible()) {
+        refreshTimer->stop();
+        hide();
+    } else {
+        reposition();
+        show();
+        raise();
+        refreshTimer->start();
+    }
+}
+
+bool LatencyOverlay::eventFilter(QObject* obj, QEvent* event) {
+    if (obj == parent() && event->type() == QEvent::Resize) {
+        reposition();
+    }
+    return false;
+}
+
+void LatencyOverlay::reposition() {
+    move(parentWidget()->width() - width() - margin, margin);
+}
+
+void LatencyOverlay::paintEvent(QPaintEvent* event) {
+    Q_UNUSED(event);
+    
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(0, 0, 0, 170));
+    painter.drawRoundedRect(rect(), 6, 6);
+    
+    const QFontMetrics metrics(font());
+    int y = padding + metrics.ascent();
+    painter.setPen(QColor("#D4D4D4"));
+    painter.drawText(padding, y, QStringLiteral("%1 %2 %3")
+        .arg(QStringLiteral("stage"), -9)
+        .arg(QStringLiteral("p50"), 7)
+        .arg(QStringLiteral("p99"), 7));
+    
+    const QVector<LatencyMonitor::Event> events = LatencyMonitor::instance().events();
+    for (int i = 0; i < LatencyMonitor::StageCount; ++i) {
+        const LatencyMonitor::Stage stage = LatencyMonitor::Stage(i);
+        const LatencyMonitor::Percentiles stats = LatencyMonitor::percentiles(events, stage);
+        y += metrics.height();
+        painter.drawText(padding, y, QStringLiteral("%1 %2 %3 ms")
+            .arg(QLatin1String(LatencyMonitor::stageName(stage)), -9)
+            .arg(stats.p50 / 1e6, 7, 'f', 2)
+            .arg(stats.p99 / 1e6, 7, 'f', 2));
+    }
+    
+    if (undoHistory) {
+        y += metrics.height();
+        painter.drawText(padding, y, QStringLiteral("%1 %2 MB")
+            .arg(QStringLiteral("undo"), -9)
+            .arg(undoHistory->memoryUsage() / (1024.0 * 1024.0), 7, 'f', 2));
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QWidget>
+
+class QTimer;
+class UndoHistory;
+
+// Small translucent panel in the top-right corner of its parent showing
+// p50/p99 per LatencyMonitor stage and the undo history's memory,
+// refreshed while it is visible.
+class LatencyOverlay : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit LatencyOverlay(QWidget* parent);
+    void toggle();
+    void setUndoHistory(const UndoHistory* history);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    bool eventFilter(QObject* obj, QEvent* event) override;
+
+private:
+    void reposition();
+
+    QTimer* refreshTimer;
+    const UndoHistory* undoHistory;
+    const int margin = 8;
+    const int padding = 8;
+    const int refreshMs = 500;
+};
@@ -0,0 +1,175 @@
+#include "line_diff.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+// Linear-space Myers: rather than keeping every step's frontier to trace
+// the path back, find the middle of an optimal path by searching from
+// both ends at once, then diff the halves on either side of it. Only the
+// two frontiers are kept, so memory stays proportional to the input.
+class Bisector {
+public:
+    Bisector(const size_t* a, const size_t* b, int size)
+        : a(a)
+        , b(b)
+        , forward(size + 2, -1)
+        , backward(size + 2, -1)
+    {
+    }
+
+    // Appends the edits turning a[aStart, aEnd) into b[bStart, bEnd); false
+    // if the first split needs more than maxSteps steps from each end
+    bool diff(int aStart, int aEnd, int bStart, int bEnd, int maxSteps, QVector<LineDiff::Hunk>* hunks) {
+        while (aStart < aEnd && bStart < bEnd && a[aStart] == b[bStart]) {
+            ++aStart;
+            ++bStart;
+        }
+        while (aStart < aEnd && bStart < bEnd && a[aEnd - 1] == b[bEnd - 1]) {
+            --aEnd;
+            --bEnd;
+        }
+        if (aStart == aEnd || bStart == bEnd) {
+            if (aStart < aEnd || bStart < bEnd) {
+                hunks->append({aStart, aEnd - aStart, bStart, bEnd - bStart});
+            }
+            return true;
+        }
+        
+        // Halves need fewer steps than the whole, so they can't run out
+        const int unlimited = (aEnd - aStart + bEnd - bStart + 1) / 2;
+        int x = 0;
+        int y = 0;
+        if (!bisect(aStart, aEnd, bStart, bEnd, maxSteps, &x, &y)) {
+            if (maxSteps < unlimited) return false;
+            hunks->append({aStart, aEnd - aStart, bStart, bEnd - bStart});
+            return true;
+        }
+        diff(aStart, x, bStart, y, unlimited, hunks);
+        diff(x, aEnd, y, bEnd, unlimited, hunks);
+        return true;
+    }
+
+private:
+    // Finds a point (x, y) on an optimal path, where the forward search
+    // from the start and the backward one from the end overlap. forward[k]
+    // is the furthest x reached on diagonal k = x - y; backward[k] the
+    // same measured from the end.
+    bool bisect(int aStart, int aEnd, int bStart, int bEnd, int maxSteps, int* splitX, int* splitY) {
+        const int n = aEnd - aStart;
+        const int m = bEnd - bStart;
+        const int steps = qMin((n + m + 1) / 2, maxSteps);
+        const int offset = (n + m + 1) / 2;
+        const int delta = n - m;
+        const bool odd = delta % 2 != 0;
+        std::fill(forward.begin(), forward.begin() + 2 * offset + 2, -1);
+        std::fill(backward.begin(), backward.begin() + 2 * offset + 2, -1);
+        forward[offset + 1] = 0;
+        backward[offset + 1] = 0;
+        
+        // Diagonals that ran off an edge are trimmed from later steps
+        int forwardStart = 0;
+        int forwardEnd = 0;
+        int backwardStart = 0;
+        int backwardEnd = 0;
+        for (int d = 0; d < steps; ++d) {
+            for (int k = -d + forwardStart; k <= d - forwardEnd; k += 2) {
+                int x = (k == -d || (k != d && forward[offset + k - 1] < forward[offset + k + 1]))
+                    ? forward[offset + k + 1]
+                    : forward[offset + k - 1] + 1;
+                int y = x - k;
+                while (x < n && y < m && a[aStart + x] == b[bStart + y]) {
+                    ++x;
+                    ++y;
+                }
+                forward[offset + k] = x;
+                if (x > n) {
+                    forwardEnd += 2;
+                } else if (y > m) {
+                    forwardStart += 2;
+                } else if (odd) {
+                    const int reverse = offset + delta - k;
+                    if (reverse >= 0 && reverse <= 2 * offset + 1 && backward[reverse] != -1
+                        && x >= n - backward[reverse]) {
+                        *splitX = aStart + x;
+                        *splitY = bStart + y;
+                        return true;
+                    }
+                }
+            }
+            for (int k = -d + backwardStart; k <= d - backwardEnd; k += 2) {
+                int x = (k == -d || (k != d && backward[offset + k - 1] < backward[offset + k + 1]))
+                    ? backward[offset + k + 1]
+                    : backward[offset + k - 1] + 1;
+                int y = x - k;
+                while (x < n && y < m && a[aEnd - 1 - x] == b[bEnd - 1 - y]) {
+                    ++x;
+                    ++y;
+                }
+                backward[offset + k] = x;
+                if (x > n) {
+                    backwardEnd += 2;
+                } else if (y > m) {
+                    backwardStart += 2;
+                } else if (!odd) {
+                    const int reverse = offset + delta - k;
+                    if (reverse >= 0 && reverse <= 2 * offset + 1 && forward[reverse] != -1) {
+                        const int forwardX = forward[reverse];
+                        const int forwardY = forwardX - (reverse - offset);
+                        if (forwardX >= n - x) {
+                            *splitX = aStart + forwardX;
+                            *splitY = bStart + forwardY;
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    const size_t* a;
+    const size_t* b;
+    std::vector<int> forward;
+    std::vector<int> backward;
+};
+}
+
+QVector<LineDiff::Hunk> LineDiff::diff(const QVector<size_t>& oldLines, const QVector<size_t>& newLines, int maxEdits) {
+    QVector<Hunk> hunks;
+    const int oldSize = int(oldLines.size());
+    const int newSize = int(newLines.size());
+    
+    // Each end covers about half the edits before the searches meet
+    Bisector bisector(oldLines.constData(), newLines.constData(), oldSize + newSize + 1);
+    if (!bisector.diff(0, oldSize, 0, newSize, maxEdits / 2 + 1, &hunks)) {
+        // Too different to be worth tracing; one replaced range between
+        // the common ends
+        int prefix = 0;
+        while (prefix < oldSize && prefix < newSize && oldLines[prefix] == newLines[prefix]) {
+            ++prefix;
+        }
+        int suffix = 0;
+        while (suffix < oldSize - prefix && suffix < newSize - prefix
+               && oldLines[oldSize - 1 - suffix] == newLines[newSize - 1 - suffix]) {
+            ++suffix;
+        }
+        hunks.clear();
+        hunks.append({prefix, oldSize - prefix - suffix, prefix, newSize - prefix - suffix});
+        return hunks;
+    }
+    
+    // Edits that meet at a split point make up one hunk
+    QVector<Hunk> merged;
+    for (const Hunk& hunk : std::as_const(hunks)) {
+        if (!merged.isEmpty()) {
+            Hunk& last = merged.last();
+            if (last.oldStart + last.oldCount == hunk.oldStart && last.newStart + last.newCount == hunk.newStart) {
+                last.oldCount += hunk.oldCount;
+                last.newCount += hunk.newCount;
+                continue;
+            }
+        }
+        merged.append(hunk);
+    }
+    return merged;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QVector>
+
+// Line diff over per-line hashes, using the linear-space variant of
+// Myers' O(ND) algorithm, so memory stays proportional to the line count
+// however many edits there are. Lines common to both ends are stripped
+// first, so the search only runs over the part that changed; when that
+// still needs more than about maxEdits insertions and deletions, it is
+// reported as one replaced range rather than traced line by line.
+class LineDiff {
+public:
+    struct Hunk {
+        int oldStart;
+        int oldCount;
+        int newStart;
+        int newCount;
+    };
+
+    static QVector<Hunk> diff(const QVector<size_t>& oldLines, const QVector<size_t>& newLines, int maxEdits = 8192);
+};
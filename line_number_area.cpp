@@ -1,13 +1,15 @@
 #include "line_number_area.h"
+#include "latency_monitor.h"
 #include <QPainter>
 #include <QTextBlock>
-#include <QScrollBar>
-#include <QDebug>
 
 LineNumberArea::LineNumberArea(CustomEditor* editor)
     : QWidget(editor)
     , editor(editor)
     , visible(true)
+    , numberCache(1024)
+    , cachedDigits(0)
+    , cachedWidth(0)
 {
     setVisible(true);
 }
@@ -22,12 +24,27 @@ QSize LineNumberArea::sizeHint() const {
     }
     
     // Calculate width based on font metrics
-    QFontMetrics metrics(editor->font());
-    int spaceWidth = metrics.horizontalAdvance(QLatin1Char('9'));
-    int width = spaceWidth * digits + 2 * horizontalPadding;
-    width = qMax(width, minWidth);
+    if (digits != cachedDigits || editor->font() != widthFont) {
+        widthFont = editor->font();
+        QFontMetrics metrics(widthFont);
+        int spaceWidth = metrics.horizontalAdvance(QLatin1Char('9'));
+        cachedWidth = qMax(spaceWidth * digits + 2 * horizontalPadding, minWidth);
+        cachedDigits = digits;
+    }
+    
+    return QSize(cachedWidth, 0);
+}
+
+const QStaticText& LineNumberArea::numberText(int number) {
+    if (QStaticText* cached = numberCache.object(number)) {
+        return *cached;
+    }
     
-    return QSize(width, 0);
+    QStaticText* text = new QStaticText(QString::number(number));
+    text->setTextFormat(Qt::PlainText);
+    text->prepare(QTransform(), cachedFont);
+    numberCache.insert(number, text);
+    return *text;
 }
 
 void LineNumberArea::setVisible(bool visible) {
@@ -47,6 +64,7 @@ void LineNumberArea::setVisible(bool visible) {
 void LineNumberArea::paintEvent(QPaintEvent* event) {
     if (!visible) return;
     
+    LatencyMonitor::Scope scope(LatencyMonitor::Paint);
     QPainter painter(this);
     
     // Match editor colors for consistency
@@ -57,26 +75,24 @@ void LineNumberArea::paintEvent(QPaintEvent* event) {
     // Fill background
     painter.fillRect(event->rect(), bgColor);
     
-    // Get viewport offset
-    int viewportOffset = editor->verticalScrollBar()->value();
+    // Set font and metrics
+    if (editor->font() != cachedFont) {
+        cachedFont = editor->font();
+        numberCache.clear();
+    }
+    painter.setFont(cachedFont);
+    painter.setPen(textColor);
+    QFontMetrics metrics(cachedFont);
     
-    // Get first visible block and its geometry
+    // Get first visible block and its position
     QTextBlock block = editor->firstVisibleBlock();
     int blockNumber = block.blockNumber();
-    QRectF blockGeometry = editor->blockBoundingGeometry(block);
-    
-    // Set font and metrics
-    painter.setFont(editor->font());
-    QFontMetrics metrics(editor->font());
+    qreal top = editor->blockBoundingGeometry(block).translated(editor->contentOffset()).top();
     
-    // Calculate initial position
-    qreal top = blockGeometry.translated(editor->contentOffset()).top();
-    
-    // Paint line numbers
-    while (block.isValid()) {
+    // Paint line numbers, stopping once past the exposed area
+    const int right = width() - horizontalPadding;
+    while (block.isValid() && top <= event->rect().bottom()) {
         if (block.isVisible()) {
-            QString number = QString::number(blockNumber + 1);
-            
             // Get block dimensions
             QRectF blockRect = editor->blockBoundingRect(block);
             bool isWrapped = blockRect.height() > metrics.height();
@@ -84,16 +100,12 @@ void LineNumberArea::paintEvent(QPaintEvent* event) {
             // For wrapped lines, only use the height of one line
             qreal drawHeight = isWrapped ? metrics.height() : blockRect.height();
             
-            // Draw the line number
-            painter.setPen(textColor);
-            painter.drawText(
-                horizontalPadding,
-                top,
-                width() - 2 * horizontalPadding,
-                drawHeight,
-                Qt::AlignRight | Qt::AlignVCenter,
-                number
-            );
+            // Draw the line number, right-aligned and vertically centered
+            if (top + blockRect.height() >= event->rect().top()) {
+                const QStaticText& number = numberText(blockNumber + 1);
+                const QSizeF size = number.size();
+                painter.drawStaticText(QPointF(right - size.width(), top + (drawHeight - size.height()) / 2), number);
+            }
             
             top += blockRect.height();
         }
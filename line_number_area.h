@@ -1,6 +1,9 @@
 #pragma once
 
 #include <QWidget>
+#include <QCache>
+#include <QFont>
+#include <QStaticText>
 #include "custom_editor.h"
 
 class LineNumberArea : public QWidget {
@@ -16,8 +19,19 @@ protected:
     void paintEvent(QPaintEvent* event) override;
 
 private:
+    const QStaticText& numberText(int number);
+
     CustomEditor* editor;
     bool visible;
+
+    // Laid-out numbers of recently painted lines, dropped on font changes
+    QCache<int, QStaticText> numberCache;
+    QFont cachedFont;
+
+    // Width only changes when the digit count or the font does
+    mutable int cachedDigits;
+    mutable int cachedWidth;
+    mutable QFont widthFont;
     const int horizontalPadding = 5;
     const int minWidth = 30;
 };
@@ -1,9 +1,38 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QTimer>
 #include "editor_window.h"
+#include "startup_profile.h"
 
 int main(int argc, char *argv[]) {
+    StartupProfile::start();
     QApplication app(argc, argv);
+    StartupProfile::mark("application created");
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("A minimalist, distraction-free text editor.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("file", "File to open; created on first save if it doesn't exist.", "[file]");
+    QCommandLineOption startupProfileOption("startup-profile", "Print a breakdown of the time to first paint.");
+    parser.addOption(startupProfileOption);
+    parser.process(app);
+    if (parser.isSet(startupProfileOption)) {
+        StartupProfile::enable();
+    }
+    
     EditorWindow editor;
+    StartupProfile::mark("window constructed");
     editor.show();
+    StartupProfile::mark("window shown");
+    
+    // Loading builds the editor's subsystems; queued so the splash frame
+    // is painted first
+    const QStringList files = parser.positionalArguments();
+    if (!files.isEmpty()) {
+        const QString filePath = files.first();
+        QTimer::singleShot(0, &editor, [&editor, filePath] {
+            editor.loadFile(filePath);
+        });
+    }
     return app.exec();
 }
@@ -0,0 +1,262 @@
+#include "piece_table.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const qint64 checkpointInterval = 256;
+const qint64 indexReadSize = 4 * 1024 * 1024;
+const qint64 writeChunkSize = 4 * 1024 * 1024;
+}
+
+PieceTable::PieceTable()
+    : mapped(nullptr)
+    , totalSize(0)
+    , totalNewlines(0)
+{
+}
+
+PieceTable::~PieceTable() {
+    close();
+}
+
+bool PieceTable::open(const QString& filePath, QString* error) {
+    close();
+
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    const qint64 size = file.size();
+    if (size > 0) {
+        mapped = file.map(0, size);
+        if (!mapped) {
+            if (error) *error = file.errorString();
+            file.close();
+            return false;
+        }
+    }
+    original.data = reinterpret_cast<const char*>(mapped);
+    original.size = size;
+
+    // Build the newline index with plain reads so the scan doesn't pull the
+    // whole mapping into this process's resident set
+    QByteArray chunk;
+    for (qint64 base = 0; base < size; base += chunk.size()) {
+        chunk = file.read(indexReadSize);
+        if (chunk.isEmpty()) break;
+        original.index(chunk.constData(), chunk.size(), base);
+    }
+
+    if (size > 0) {
+        pieces.append({false, 0, size, original.newlines});
+    }
+    totalSize = size;
+    totalNewlines = original.newlines;
+    return true;
+}
+
+void PieceTable::close() {
+    if (mapped) {
+        file.unmap(mapped);
+        mapped = nullptr;
+    }
+    file.close();
+
+    original = Buffer();
+    addBuffer = Buffer();
+    addData.clear();
+    pieces.clear();
+    totalSize = 0;
+    totalNewlines = 0;
+}
+
+void PieceTable::Buffer::index(const char* chunk, qint64 length, qint64 base) {
+    const char* end = chunk + length;
+    for (const char* p = chunk; p < end; ++p) {
+        p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!p) break;
+        if (newlines % checkpointInterval == 0) {
+            checkpoints.append(base + (p - chunk));
+        }
+        ++newlines;
+    }
+}
+
+qint64 PieceTable::Buffer::newlinesBefore(qint64 offset) const {
+    // Start from the last checkpoint before offset and count the rest by hand
+    qint64 count = 0;
+    qint64 from = 0;
+    auto it = std::lower_bound(checkpoints.cbegin(), checkpoints.cend(), offset);
+    if (it != checkpoints.cbegin()) {
+        --it;
+        count = (it - checkpoints.cbegin()) * checkpointInterval + 1;
+        from = *it + 1;
+    }
+
+    const char* end = data + offset;
+    for (const char* p = data + from; p < end; ++p) {
+        p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!p) break;
+        ++count;
+    }
+    return count;
+}
+
+qint64 PieceTable::Buffer::nthNewline(qint64 n) const {
+    const qint64 checkpoint = n / checkpointInterval;
+    qint64 pos = checkpoints[checkpoint];
+    for (qint64 remaining = n - checkpoint * checkpointInterval; remaining > 0; --remaining) {
+        pos = static_cast<const char*>(std::memchr(data + pos + 1, '\n', size - pos - 1)) - data;
+    }
+    return pos;
+}
+
+qint64 PieceTable::countNewlines(bool added, qint64 start, qint64 length) const {
+    const Buffer& buffer = added ? addBuffer : original;
+    return buffer.newlinesBefore(start + length) - buffer.newlinesBefore(start);
+}
+
+int PieceTable::splitAt(qint64 offset) {
+    qint64 pos = 0;
+    for (int i = 0; i < pieces.size(); ++i) {
+        if (offset == pos) return i;
+
+        Piece& piece = pieces[i];
+        if (offset < pos + piece.length) {
+            const qint64 leftLength = offset - pos;
+            const qint64 leftNewlines = countNewlines(piece.added, piece.start, leftLength);
+            const Piece right{piece.added, piece.start + leftLength,
+                              piece.length - leftLength, piece.newlines - leftNewlines};
+            piece.length = leftLength;
+            piece.newlines = leftNewlines;
+            pieces.insert(i + 1, right);
+            return i + 1;
+        }
+        pos += piece.length;
+    }
+    return pieces.size();
+}
+
+qint64 PieceTable::lineStart(qint64 line) const {
+    if (line <= 0) return 0;
+    if (line > totalNewlines) return totalSize;
+
+    // The line starts right after the newline that ends the previous one
+    const qint64 target = line - 1;
+    qint64 pos = 0;
+    qint64 seen = 0;
+    for (const Piece& piece : pieces) {
+        if (seen + piece.newlines > target) {
+            const Buffer& buffer = bufferOf(piece);
+            const qint64 n = buffer.newlinesBefore(piece.start) + (target - seen);
+            return pos + (buffer.nthNewline(n) - piece.start) + 1;
+        }
+        seen += piece.newlines;
+        pos += piece.length;
+    }
+    return totalSize;
+}
+
+qint64 PieceTable::lineEnd(qint64 line) const {
+    if (line >= totalNewlines) return totalSize;
+    return lineStart(line + 1) - 1;
+}
+
+qint64 PieceTable::lineOfOffset(qint64 offset) const {
+    qint64 pos = 0;
+    qint64 seen = 0;
+    for (const Piece& piece : pieces) {
+        if (offset < pos + piece.length) {
+            const Buffer& buffer = bufferOf(piece);
+            return seen + buffer.newlinesBefore(piece.start + (offset - pos))
+                        - buffer.newlinesBefore(piece.start);
+        }
+        seen += piece.newlines;
+        pos += piece.length;
+    }
+    return totalNewlines;
+}
+
+QByteArray PieceTable::text(qint64 offset, qint64 length) const {
+    QByteArray result;
+    const qint64 end = qMin(offset + length, totalSize);
+    if (offset >= end) return result;
+
+    result.reserve(end - offset);
+    qint64 pos = 0;
+    for (const Piece& piece : pieces) {
+        const qint64 pieceEnd = pos + piece.length;
+        if (pieceEnd > offset) {
+            const qint64 from = qMax(offset, pos);
+            const qint64 to = qMin(end, pieceEnd);
+            result.append(bufferOf(piece).data + piece.start + (from - pos), to - from);
+        }
+        if (pieceEnd >= end) break;
+        pos = pieceEnd;
+    }
+    return result;
+}
+
+void PieceTable::insert(qint64 offset, const QByteArray& text) {
+    if (text.isEmpty()) return;
+
+    const qint64 start = addData.size();
+    const qint64 newlinesBefore = addBuffer.newlines;
+    addData.append(text);
+    addBuffer.data = addData.constData();
+    addBuffer.size = addData.size();
+    addBuffer.index(addData.constData() + start, text.size(), start);
+    const qint64 newlines = addBuffer.newlines - newlinesBefore;
+
+    totalSize += text.size();
+    totalNewlines += newlines;
+
+    // Consecutive typing extends the previous added piece instead of adding one
+    const int at = splitAt(offset);
+    if (at > 0) {
+        Piece& previous = pieces[at - 1];
+        if (previous.added && previous.start + previous.length == start) {
+            previous.length += text.size();
+            previous.newlines += newlines;
+            return;
+        }
+    }
+    pieces.insert(at, {true, start, text.size(), newlines});
+}
+
+void PieceTable::remove(qint64 offset, qint64 length) {
+    length = qMin(length, totalSize - offset);
+    if (length <= 0) return;
+
+    const int first = splitAt(offset);
+    const int last = splitAt(offset + length);
+
+    qint64 removedNewlines = 0;
+    for (int i = first; i < last; ++i) {
+        removedNewlines += pieces[i].newlines;
+    }
+    pieces.remove(first, last - first);
+
+    totalSize -= length;
+    totalNewlines -= removedNewlines;
+}
+
+FileSaver::Writer PieceTable::writer() const {
+    const char* originalData = original.data;
+    const QByteArray added = addData;
+    const QVector<Piece> snapshot = pieces;
+
+    return [originalData, added, snapshot](QIODevice* device) {
+        for (const Piece& piece : snapshot) {
+            const char* data = (piece.added ? added.constData() : originalData) + piece.start;
+            for (qint64 written = 0; written < piece.length; ) {
+                const qint64 count = qMin(piece.length - written, writeChunkSize);
+                if (device->write(data + written, count) != count) return false;
+                written += count;
+            }
+        }
+        return true;
+    };
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "file_saver.h"
+
+// Byte-level piece table over a memory-mapped original file plus an
+// append-only buffer for inserted text. Line lookups go through sparse
+// newline checkpoints, so memory stays small no matter how large the file is.
+class PieceTable {
+public:
+    PieceTable();
+    ~PieceTable();
+
+    bool open(const QString& filePath, QString* error = nullptr);
+    void close();
+
+    qint64 size() const { return totalSize; }
+    qint64 lineCount() const { return totalNewlines + 1; }
+    qint64 lineStart(qint64 line) const;
+    qint64 lineEnd(qint64 line) const;  // Offset of the line's '\n', or size() for the last line
+    qint64 lineOfOffset(qint64 offset) const;
+    QByteArray text(qint64 offset, qint64 length) const;
+
+    void insert(qint64 offset, const QByteArray& text);
+    void remove(qint64 offset, qint64 length);
+
+    // Captures the current pieces for a background save. The original
+    // mapping must stay open until the save has finished.
+    FileSaver::Writer writer() const;
+
+private:
+    struct Buffer {
+        const char* data = nullptr;
+        qint64 size = 0;
+        qint64 newlines = 0;
+        QVector<qint64> checkpoints;  // Offset of every checkpointInterval-th newline
+
+        void index(const char* chunk, qint64 length, qint64 base);
+        qint64 newlinesBefore(qint64 offset) const;
+        qint64 nthNewline(qint64 n) const;
+    };
+
+    struct Piece {
+        bool added;
+        qint64 start;
+        qint64 length;
+        qint64 newlines;
+    };
+
+    const Buffer& bufferOf(const Piece& piece) const { return piece.added ? addBuffer : original; }
+    qint64 countNewlines(bool added, qint64 start, qint64 length) const;
+    int splitAt(qint64 offset);
+
+    QFile file;
+    uchar* mapped;
+    Buffer original;
+    Buffer addBuffer;
+    QByteArray addData;
+    QVector<Piece> pieces;
+    qint64 totalSize;
+    qint64 totalNewlines;
+};
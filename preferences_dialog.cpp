@@ -1,4 +1,5 @@
 #include "preferences_dialog.h"
+#include "settings_store.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
@@ -77,3 +78,15 @@ QFont PreferencesDialog::getSelectedFont() const
     font.setFixedPitch(true);
     return font;
 }
+
+void PreferencesDialog::applyChanges() const
+{
+    const QFont font = getSelectedFont();
+    SettingsStore& settings = SettingsStore::instance();
+    if (font.family() != settings.fontFamily()) {
+        settings.setValue(SettingsStore::FontFamily, font.family());
+    }
+    if (font.pointSize() != settings.fontSize()) {
+        settings.setValue(SettingsStore::FontSize, font.pointSize());
+    }
+}
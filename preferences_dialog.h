@@ -12,6 +12,7 @@ class PreferencesDialog : public QDialog {
 public:
     PreferencesDialog(const QFont& currentFont, QWidget* parent = nullptr);
     QFont getSelectedFont() const;
+    void applyChanges() const;  // Stores only the settings that differ
 
 private slots:
     void previewFont();
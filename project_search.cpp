@@ -0,0 +1,311 @@
+#include "project_search.h"
+#include "worker_job.h"
+#include <QByteArrayMatcher>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace {
+const int maxResults = 10000;        // Search stops once this many lines matched
+const int maxMatchesPerFile = 1000;
+const qint64 binaryProbeSize = 8192;
+const int maxLineLength = 300;       // Longer lines are cut in results
+
+// One .gitignore pattern
+struct IgnoreRule {
+    QRegularExpression pattern;
+    bool directoryOnly;
+    bool anchored;  // Matched against the path from the root rather than the name
+};
+
+QVector<IgnoreRule> readIgnoreRules(const QString& rootPath) {
+    QVector<IgnoreRule> rules;
+    QFile file(QDir(rootPath).filePath(QStringLiteral(".gitignore")));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return rules;
+    
+    // Plain globs only; negations are not supported and simply skipped
+    while (!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')) || line.startsWith(QLatin1Char('!'))) continue;
+        
+        IgnoreRule rule;
+        rule.directoryOnly = line.endsWith(QLatin1Char('/'));
+        if (rule.directoryOnly) {
+            line.chop(1);
+        }
+        rule.anchored = line.contains(QLatin1Char('/'));
+        if (line.startsWith(QLatin1Char('/'))) {
+            line.remove(0, 1);
+        }
+        rule.pattern = QRegularExpression(QRegularExpression::wildcardToRegularExpression(line));
+        if (rule.pattern.isValid()) {
+            rules.append(rule);
+        }
+    }
+    return rules;
+}
+}
+
+struct ProjectSearch::Task {
+    QString path;
+    bool directory;
+};
+
+struct ProjectSearch::Job {
+    // Each worker's deque; the owner works from the back, thieves from the front
+    struct Queue {
+        QMutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    QString rootPath;
+    QByteArray needle;
+    QByteArrayMatcher matcher;
+    QVector<IgnoreRule> ignoreRules;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<int> outstanding{0};  // Tasks queued or being worked on
+    std::atomic<int> workersLeft{0};
+    std::atomic<int> results{0};
+    std::atomic<int> filesSearched{0};
+    std::atomic<bool> truncated{false};  // Hit maxResults; stops the workers like a cancel
+    std::atomic<bool> canceled{false};
+    
+    // Idle workers wait here; 'generation' moves on whenever tasks are
+    // queued or the search ends, so a wakeup between looking and waiting
+    // isn't lost
+    QMutex idleMutex;
+    QWaitCondition workAvailable;
+    std::atomic<int> generation{0};
+    
+    QMutex mutex;
+    ProjectSearch* receiver = nullptr;  // Cleared once the search stops listening
+};
+
+ProjectSearch::ProjectSearch(QObject* parent)
+    : QObject(parent)
+{
+    // Its destructor waits for the workers, which cancel() wakes
+    pool = new QThreadPool(this);
+    pool->setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+ProjectSearch::~ProjectSearch() {
+    cancel();
+}
+
+void ProjectSearch::start(const QString& rootPath, const QString& needle) {
+    cancel();
+    if (needle.isEmpty()) return;
+    
+    job = std::make_shared<Job>();
+    job->rootPath = QDir(rootPath).absolutePath();
+    job->needle = needle.toUtf8();
+    job->matcher.setPattern(job->needle);
+    job->ignoreRules = readIgnoreRules(job->rootPath);
+    job->receiver = this;
+    
+    const int workers = pool->maxThreadCount();
+    for (int i = 0; i < workers; ++i) {
+        job->queues.push_back(std::make_unique<Job::Queue>());
+    }
+    job->queues[0]->tasks.push_back({job->rootPath, true});
+    job->outstanding = 1;
+    job->workersLeft = workers;
+    
+    for (int i = 0; i < workers; ++i) {
+        std::shared_ptr<Job> started = job;
+        pool->start([started, i] { work(started, i); });
+    }
+}
+
+void ProjectSearch::cancel() {
+    if (!job) return;
+    
+    job->canceled = true;
+    wake(*job);
+    {
+        QMutexLocker locker(&job->mutex);
+        job->receiver = nullptr;
+    }
+    job.reset();
+}
+
+void ProjectSearch::wake(Job& job) {
+    QMutexLocker locker(&job.idleMutex);
+    ++job.generation;
+    job.workAvailable.wakeAll();
+}
+
+void ProjectSearch::post(const std::shared_ptr<Job>& job, std::function<void(ProjectSearch*)> fn) {
+    // Results of a job that has since been replaced are dropped on arrival
+    postJobResult(job, &ProjectSearch::job, std::move(fn));
+}
+
+void ProjectSearch::work(std::shared_ptr<Job> job, int index) {
+    const int workers = int(job->queues.size());
+    Job::Queue& own = *job->queues[index];
+    
+    while (!job->canceled && !job->truncated && job->outstanding > 0) {
+        const int generation = job->generation;
+        Task task;
+        bool found = false;
+        {
+            QMutexLocker locker(&own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                found = true;
+            }
+        }
+        
+        // Steal the oldest task of another worker; near the root those are
+        // the directories with the most work under them
+        for (int i = 1; !found && i < workers; ++i) {
+            Job::Queue& victim = *job->queues[(index + i) % workers];
+            QMutexLocker locker(&victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                found = true;
+            }
+        }
+        
+        if (!found) {
+            // Others are still expanding directories that may produce work
+            QMutexLocker locker(&job->idleMutex);
+            if (job->generation == generation && !job->canceled && !job->truncated && job->outstanding > 0) {
+                job->workAvailable.wait(&job->idleMutex);
+            }
+            continue;
+        }
+        
+        if (task.directory) {
+            visitDirectory(*job, index, task.path);
+        } else {
+            searchFile(job, task.path);
+        }
+        if (--job->outstanding == 0) {
+            wake(*job);
+        }
+    }
+    
+    // The last worker out reports completion
+    if (--job->workersLeft == 0 && !job->canceled) {
+        const int files = job->filesSearched;
+        const bool truncated = job->truncated;
+        post(job, [files, truncated](ProjectSearch* search) {
+            search->job.reset();
+            emit search->finished(files, truncated);
+        });
+    }
+}
+
+void ProjectSearch::visitDirectory(Job& job, int index, const QString& path) {
+    // Hidden entries (.git and friends) are left out by the filter itself
+    std::vector<Task> tasks;
+    QDirIterator it(path, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        const bool directory = info.isDir();
+        if (!ignored(job, info.filePath(), directory)) {
+            tasks.push_back({info.filePath(), directory});
+        }
+    }
+    
+    if (tasks.empty()) return;
+    
+    // Counted before they become visible, so no worker sees a false zero
+    job.outstanding += int(tasks.size());
+    Job::Queue& own = *job.queues[index];
+    {
+        QMutexLocker locker(&own.mutex);
+        for (Task& task : tasks) {
+            own.tasks.push_back(std::move(task));
+        }
+    }
+    wake(job);
+}
+
+bool ProjectSearch::ignored(const Job& job, const QString& path, bool directory) {
+    const QString name = path.mid(path.lastIndexOf(QLatin1Char('/')) + 1);
+    if (directory && name == QLatin1String("node_modules")) return true;
+    
+    const QString relative = path.mid(job.rootPath.size() + 1);
+    for (const IgnoreRule& rule : job.ignoreRules) {
+        if (rule.directoryOnly && !directory) continue;
+        if (rule.pattern.match(rule.anchored ? relative : name).hasMatch()) return true;
+    }
+    return false;
+}
+
+void ProjectSearch::searchFile(const std::shared_ptr<Job>& job, const QString& path) {
+    if (job->results >= maxResults) {
+        job->truncated = true;
+        wake(*job);
+        return;
+    }
+    
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    const qint64 size = file.size();
+    if (size < job->needle.size()) return;
+    
+    // Mapped where possible; the page cache does the rest
+    QByteArray buffer;
+    const char* data = reinterpret_cast<const char*>(file.map(0, size));
+    if (!data) {
+        buffer = file.readAll();
+        data = buffer.constData();
+    }
+    ++job->filesSearched;
+    
+    if (std::memchr(data, '\0', size_t(qMin(size, binaryProbeSize)))) return;
+    
+    // One result per matching line; the line number is carried forward
+    // from the previous match rather than counted from the start each time
+    QVector<Match> matches;
+    int line = 0;
+    qint64 counted = 0;
+    qint64 lineStart = 0;
+    qint64 from = 0;
+    while (matches.size() < maxMatchesPerFile) {
+        const qint64 position = job->matcher.indexIn(data, size, from);
+        if (position < 0) break;
+        
+        while (const void* found = std::memchr(data + counted, '\n', size_t(position - counted))) {
+            ++line;
+            lineStart = static_cast<const char*>(found) - data + 1;
+            counted = lineStart;
+        }
+        counted = position;
+        const char* newline = static_cast<const char*>(std::memchr(data + position, '\n', size_t(size - position)));
+        const qint64 lineEnd = newline ? newline - data : size;
+        
+        Match match;
+        match.filePath = path;
+        match.line = line;
+        match.column = int(QString::fromUtf8(data + lineStart, position - lineStart).size());
+        match.text = QString::fromUtf8(data + lineStart, qMin<qint64>(lineEnd - lineStart, maxLineLength)).trimmed();
+        matches.append(match);
+        from = lineEnd + 1;
+    }
+    
+    if (!matches.isEmpty()) {
+        job->results += int(matches.size());
+        post(job, [matches = std::move(matches)](ProjectSearch* search) {
+            emit search->matchesFound(matches);
+        });
+    }
+}
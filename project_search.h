@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+class QThreadPool;
+
+// Searches every file under a directory for a literal string, like grep.
+// Workers each own a deque of directories and files to visit; they take
+// from the back of their own and, when it runs dry, steal from the front
+// of the others', so one deep directory doesn't leave the rest idle. A
+// worker that finds nothing to steal sleeps until more is queued. The
+// workers run on a pool of their own, so a search never holds up loading,
+// saving or highlighting on the global one. Files are memory-mapped, binaries (a NUL byte near
+// the start) are skipped, and so are hidden entries, node_modules and the
+// patterns in the root's .gitignore. Results stream back one file at a
+// time; a cap on the total keeps memory bounded.
+class ProjectSearch : public QObject {
+    Q_OBJECT
+
+public:
+    struct Match {
+        QString filePath;
+        int line;    // 0-based
+        int column;  // In QChars
+        QString text;
+    };
+
+    explicit ProjectSearch(QObject* parent = nullptr);
+    ~ProjectSearch();
+
+    void start(const QString& rootPath, const QString& needle);
+    void cancel();
+    bool isRunning() const { return job != nullptr; }
+
+signals:
+    void matchesFound(const QVector<ProjectSearch::Match>& matches);
+    void finished(int filesSearched, bool truncated);
+
+private:
+    struct Job;
+    struct Task;
+    static void work(std::shared_ptr<Job> job, int index);
+    static void visitDirectory(Job& job, int index, const QString& path);
+    static void searchFile(const std::shared_ptr<Job>& job, const QString& path);
+    static bool ignored(const Job& job, const QString& path, bool directory);
+    static void post(const std::shared_ptr<Job>& job, std::function<void(ProjectSearch*)> fn);
+    static void wake(Job& job);
+
+    QThreadPool* pool;
+    std::shared_ptr<Job> job;
+};
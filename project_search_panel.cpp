@@ -0,0 +1,121 @@
+#include "project_search_panel.h"
+#include <QDir>
+#include <QHBoxLayout>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QVBoxLayout>
+
+namespace {
+const int filePathRole = Qt::UserRole;
+const int lineRole = Qt::UserRole + 1;
+}
+
+ProjectSearchPanel::ProjectSearchPanel(QWidget* parent)
+    : QWidget(parent)
+    , resultCount(0)
+{
+    auto layout = new QVBoxLayout(this);
+    layout->setContentsMargins(8, 4, 8, 4);
+    layout->setSpacing(4);
+    
+    auto queryRow = new QWidget(this);
+    auto queryLayout = new QHBoxLayout(queryRow);
+    queryLayout->setContentsMargins(0, 0, 0, 0);
+    
+    input = new QLineEdit;
+    input->setPlaceholderText(tr("Search project"));
+    input->setFrame(false);
+    input->installEventFilter(this);
+    queryLayout->addWidget(input);
+    
+    statusLabel = new QLabel;
+    queryLayout->addWidget(statusLabel);
+    layout->addWidget(queryRow);
+    
+    results = new QListWidget;
+    results->setFrameStyle(0);
+    results->setUniformItemSizes(true);  // Keeps appending thousands of rows cheap
+    results->installEventFilter(this);
+    layout->addWidget(results);
+    
+    search = new ProjectSearch(this);
+    connect(search, &ProjectSearch::matchesFound, this, &ProjectSearchPanel::addMatches);
+    connect(search, &ProjectSearch::finished, this, &ProjectSearchPanel::finishSearch);
+    connect(input, &QLineEdit::returnPressed, this, &ProjectSearchPanel::startSearch);
+    connect(results, &QListWidget::itemActivated, this, &ProjectSearchPanel::activateItem);
+    
+    setFixedHeight(panelHeight);
+    setAutoFillBackground(true);
+    hide();
+}
+
+void ProjectSearchPanel::activate(const QString& rootPath, const QString& text) {
+    this->rootPath = rootPath;
+    if (!text.isEmpty()) {
+        input->setText(text);
+    }
+    show();
+    input->setFocus();
+    input->selectAll();
+}
+
+void ProjectSearchPanel::startSearch() {
+    results->clear();
+    resultCount = 0;
+    if (input->text().isEmpty()) {
+        search->cancel();
+        statusLabel->clear();
+        return;
+    }
+    
+    statusLabel->setText(tr("Searching %1...").arg(QDir::toNativeSeparators(rootPath)));
+    search->start(rootPath, input->text());
+}
+
+void ProjectSearchPanel::addMatches(const QVector<ProjectSearch::Match>& matches) {
+    const QDir root(rootPath);
+    for (const ProjectSearch::Match& match : matches) {
+        auto item = new QListWidgetItem(QStringLiteral("%1:%2: %3")
+            .arg(QDir::toNativeSeparators(root.relativeFilePath(match.filePath)))
+            .arg(match.line + 1)
+            .arg(match.text));
+        item->setData(filePathRole, match.filePath);
+        item->setData(lineRole, match.line);
+        results->addItem(item);
+    }
+    resultCount += matches.size();
+}
+
+void ProjectSearchPanel::finishSearch(int filesSearched, bool truncated) {
+    QString status = tr("%1 lines in %2 files").arg(resultCount).arg(filesSearched);
+    if (truncated) {
+        status += tr(" (stopped early)");
+    }
+    statusLabel->setText(status);
+}
+
+void ProjectSearchPanel::activateItem(QListWidgetItem* item) {
+    emit resultActivated(item->data(filePathRole).toString(), item->data(lineRole).toInt());
+}
+
+bool ProjectSearchPanel::eventFilter(QObject* obj, QEvent* event) {
+    if ((obj == input || obj == results) && event->type() == QEvent::KeyPress) {
+        QKeyEvent* keyEvent = static_cast<QKeyEvent*>(event);
+        if (keyEvent->key() == Qt::Key_Escape) {
+            search->cancel();
+            hide();
+            emit closed();
+            return true;
+        }
+        
+        // Down from the query moves into the results
+        if (obj == input && keyEvent->key() == Qt::Key_Down && results->count() > 0) {
+            results->setFocus();
+            results->setCurrentRow(0);
+            return true;
+        }
+    }
+    return QWidget::eventFilter(obj, event);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QVector>
+#include <QWidget>
+#include "project_search.h"
+
+class QLabel;
+class QLineEdit;
+class QListWidget;
+class QListWidgetItem;
+
+// Project search panel below the editor: a query field and a list that
+// fills in as ProjectSearch reports matching lines.
+class ProjectSearchPanel : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit ProjectSearchPanel(QWidget* parent = nullptr);
+    void activate(const QString& rootPath, const QString& text = QString());
+
+signals:
+    void resultActivated(const QString& filePath, int line);
+    void closed();
+
+protected:
+    bool eventFilter(QObject* obj, QEvent* event) override;
+
+private slots:
+    void startSearch();
+    void addMatches(const QVector<ProjectSearch::Match>& matches);
+    void finishSearch(int filesSearched, bool truncated);
+    void activateItem(QListWidgetItem* item);
+
+private:
+    ProjectSearch* search;
+    QString rootPath;
+    QLineEdit* input;
+    QLabel* statusLabel;
+    QListWidget* results;
+    int resultCount;
+    const int panelHeight = 240;
+};
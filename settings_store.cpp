@@ -0,0 +1,66 @@
+#include "settings_store.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QTimer>
+
+SettingsStore& SettingsStore::instance() {
+    static SettingsStore store;
+    return store;
+}
+
+SettingsStore::SettingsStore()
+{
+    // The only synchronous read
+    QSettings settings("Focused Editor", "Editor");
+    const QStringList keys = settings.allKeys();
+    for (const QString& key : keys) {
+        values.insert(key, settings.value(key));
+    }
+    
+    writer.setMaxThreadCount(1);
+    
+    // Changes made in quick succession, like a preferences dialog applying
+    // several keys, go out as one write
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(flushDelayMs);
+    connect(flushTimer, &QTimer::timeout, this, &SettingsStore::flush);
+    
+    // Nothing still queued may be lost on the way out
+    if (QCoreApplication* app = QCoreApplication::instance()) {
+        connect(app, &QCoreApplication::aboutToQuit, this, &SettingsStore::sync);
+    }
+}
+
+QVariant SettingsStore::value(const QString& key, const QVariant& defaultValue) const {
+    return values.value(key, defaultValue);
+}
+
+void SettingsStore::setValue(const QString& key, const QVariant& value) {
+    const auto it = values.constFind(key);
+    if (it != values.cend() && *it == value) return;
+    
+    values.insert(key, value);
+    unwritten.insert(key, value);
+    flushTimer->start();
+    emit valueChanged(key, value);
+}
+
+void SettingsStore::flush() {
+    flushTimer->stop();
+    if (unwritten.isEmpty()) return;
+    
+    writer.start([batch = std::move(unwritten)] {
+        QSettings settings("Focused Editor", "Editor");
+        for (auto it = batch.cbegin(); it != batch.cend(); ++it) {
+            settings.setValue(it.key(), it.value());
+        }
+        settings.sync();
+    });
+    unwritten.clear();
+}
+
+void SettingsStore::sync() {
+    flush();
+    writer.waitForDone();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QVariant>
+
+class QTimer;
+
+// Application settings held in memory. Everything is read from QSettings
+// once, on first use; reads are served from memory and writes are batched
+// and written out on a background thread, so the UI thread never touches
+// the settings file or registry after startup. Every change is announced
+// with the key that changed so listeners can update just that.
+class SettingsStore : public QObject {
+    Q_OBJECT
+
+public:
+    // Keys
+    static constexpr const char* FontFamily = "font/family";
+    static constexpr const char* FontSize = "font/size";
+    static constexpr const char* LargeFileThresholdMB = "largeFile/thresholdMB";
+    static constexpr const char* UndoBudgetMB = "undo/budgetMB";
+
+    static SettingsStore& instance();
+
+    QVariant value(const QString& key, const QVariant& defaultValue = QVariant()) const;
+    void setValue(const QString& key, const QVariant& value);
+
+    // Typed accessors that own the defaults
+    QString fontFamily() const { return value(FontFamily, "Menlo").toString(); }
+    int fontSize() const { return value(FontSize, 13).toInt(); }
+    qint64 largeFileThresholdMB() const { return value(LargeFileThresholdMB, 256).toLongLong(); }
+    qint64 undoBudgetMB() const { return value(UndoBudgetMB, 64).toLongLong(); }
+
+    // Writes out pending changes and waits until they are on disk
+    void sync();
+
+signals:
+    void valueChanged(const QString& key, const QVariant& value);
+
+private:
+    SettingsStore();
+    void flush();
+
+    QHash<QString, QVariant> values;
+    QHash<QString, QVariant> unwritten;  // Changed since the last flush
+    QTimer* flushTimer;
+    QThreadPool writer;  // One thread, so batches land in order
+    const int flushDelayMs = 500;
+};
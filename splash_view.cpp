@@ -0,0 +1,40 @@
+#include "splash_view.h"
+#include "startup_profile.h"
+#include <QPainter>
+#include <QPaintEvent>
+
+SplashView::SplashView(QWidget* parent)
+    : QWidget(parent)
+{
+    setFocusPolicy(Qt::StrongFocus);
+}
+
+void SplashView::paintEvent(QPaintEvent* event) {
+    QPainter painter(this);
+    painter.fillRect(event->rect(), palette().color(QPalette::Base));
+    painter.setPen(palette().color(QPalette::Text));
+    
+    const QStringList lines = {
+        tr("Welcome to Focused Editor"),
+        QString(),
+        tr("A minimalist text editor for distraction-free coding."),
+        QString(),
+#ifdef Q_OS_MAC
+        tr("Press Cmd+O to open a file"),
+#else
+        tr("Press Ctrl+O to open a file"),
+#endif
+        tr("- or -"),
+        tr("Start typing to create a new file")
+    };
+    
+    // Centered horizontally, starting about 30% down like the old document splash
+    const int lineHeight = fontMetrics().height();
+    int top = height() * 3 / 10;
+    for (const QString& line : lines) {
+        painter.drawText(QRect(0, top, width(), lineHeight), Qt::AlignHCenter | Qt::AlignVCenter, line);
+        top += lineHeight;
+    }
+    
+    StartupProfile::firstPaint();
+}
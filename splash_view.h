@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QWidget>
+
+// Welcome screen drawn straight onto the widget, so the first frame needs
+// neither a document nor any of the editor's subsystems.
+class SplashView : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit SplashView(QWidget* parent = nullptr);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+};
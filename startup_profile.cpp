@@ -0,0 +1,44 @@
+#include "startup_profile.h"
+#include <QDebug>
+
+QElapsedTimer StartupProfile::clock;
+QVector<StartupProfile::Mark> StartupProfile::marks;
+bool StartupProfile::enabled = false;
+bool StartupProfile::painted = false;
+
+void StartupProfile::start() {
+    clock.start();
+}
+
+void StartupProfile::enable() {
+    enabled = true;
+}
+
+void StartupProfile::mark(const char* stage) {
+    // Only startup is of interest; later marks would just grow the list
+    if (painted || !clock.isValid()) return;
+    marks.append({stage, clock.nsecsElapsed()});
+}
+
+void StartupProfile::firstPaint() {
+    if (painted) return;
+    
+    mark("first paint");
+    painted = true;
+    if (enabled) {
+        report();
+    }
+    marks.clear();
+}
+
+void StartupProfile::report() {
+    qInfo().noquote() << "Startup profile (ms since main):";
+    qint64 previous = 0;
+    for (const Mark& mark : std::as_const(marks)) {
+        qInfo().noquote() << QStringLiteral("  %1 %2  (+%3)")
+            .arg(QLatin1String(mark.stage), -24)
+            .arg(mark.nsecs / 1e6, 8, 'f', 2)
+            .arg((mark.nsecs - previous) / 1e6, 0, 'f', 2);
+        previous = mark.nsecs;
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QVector>
+
+// Cold-start timing. Stages are timestamped from the start of main() and,
+// with --startup-profile, printed as a breakdown once the first frame has
+// been painted.
+class StartupProfile {
+public:
+    static void start();
+    static void enable();
+    static void mark(const char* stage);
+    static void firstPaint();
+
+private:
+    struct Mark {
+        const char* stage;
+        qint64 nsecs;
+    };
+
+    static void report();
+
+    static QElapsedTimer clock;
+    static QVector<Mark> marks;
+    static bool enabled;
+    static bool painted;
+};
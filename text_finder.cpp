@@ -0,0 +1,95 @@
+#include "text_finder.h"
+#include "worker_job.h"
+#include "text_search.h"
+#include <QMutex>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <atomic>
+
+struct TextFinder::Job {
+    QString text;  // Shares the caller's snapshot; never copied
+    QString needle;
+    Qt::CaseSensitivity cs;
+    bool regex;
+    std::atomic<bool> canceled{false};
+    QMutex mutex;
+    TextFinder* receiver = nullptr;  // Cleared once the finder stops listening
+};
+
+TextFinder::TextFinder(QObject* parent)
+    : QObject(parent)
+{
+}
+
+TextFinder::~TextFinder() {
+    cancel();
+}
+
+void TextFinder::start(const QString& text, const QString& needle, Qt::CaseSensitivity cs, bool regex) {
+    cancel();
+    
+    job = std::make_shared<Job>();
+    job->text = text;
+    job->needle = needle;
+    job->cs = cs;
+    job->regex = regex;
+    job->receiver = this;
+    
+    std::shared_ptr<Job> started = job;
+    QThreadPool::globalInstance()->start([started] { run(started); });
+}
+
+void TextFinder::cancel() {
+    if (!job) return;
+    
+    job->canceled = true;
+    {
+        QMutexLocker locker(&job->mutex);
+        job->receiver = nullptr;
+    }
+    job.reset();
+}
+
+void TextFinder::post(const std::shared_ptr<Job>& job, std::function<void(TextFinder*)> fn) {
+    // Results of a job that has since been replaced are dropped on arrival
+    postJobResult(job, &TextFinder::job, std::move(fn));
+}
+
+void TextFinder::run(std::shared_ptr<Job> job) {
+    QVector<qsizetype> positions;
+    QVector<qsizetype> lengths;
+    const qsizetype count = job->regex
+        ? findRegex(*job, positions, lengths)
+        : TextSearch::findAll(job->text, job->needle, job->cs, &positions, maxPositions, &job->canceled);
+    if (count < 0) return;
+    
+    post(job, [positions = std::move(positions), lengths = std::move(lengths), count](TextFinder* finder) {
+        finder->job.reset();
+        emit finder->finished(positions, lengths, count);
+    });
+}
+
+qsizetype TextFinder::findRegex(const Job& job, QVector<qsizetype>& positions, QVector<qsizetype>& lengths) {
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+    if (job.cs == Qt::CaseInsensitive) {
+        options |= QRegularExpression::CaseInsensitiveOption;
+    }
+    const QRegularExpression expression(job.needle, options);
+    if (!expression.isValid()) return 0;
+    
+    // Empty matches can't be shown or stepped through, so they don't count
+    qsizetype count = 0;
+    QRegularExpressionMatchIterator it = expression.globalMatch(job.text);
+    while (it.hasNext()) {
+        if (job.canceled.load(std::memory_order_relaxed)) return -1;
+        
+        const QRegularExpressionMatch match = it.next();
+        if (match.capturedLength() == 0) continue;
+        if (positions.size() < maxPositions) {
+            positions.append(match.capturedStart());
+            lengths.append(match.capturedLength());
+        }
+        ++count;
+    }
+    return count;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+// Runs TextSearch, or a regular expression, over a snapshot of the document
+// on a worker thread. Starting a new search cancels the one in flight, so
+// each keystroke in the find bar abandons the scan for the previous needle.
+class TextFinder : public QObject {
+    Q_OBJECT
+
+public:
+    explicit TextFinder(QObject* parent = nullptr);
+    ~TextFinder();
+
+    void start(const QString& text, const QString& needle, Qt::CaseSensitivity cs, bool regex = false);
+    void cancel();
+    bool isRunning() const { return job != nullptr; }
+
+signals:
+    // positions holds at most the first maxPositions offsets; count is exact.
+    // lengths is only filled for regular expressions, whose matches vary.
+    void finished(const QVector<qsizetype>& positions, const QVector<qsizetype>& lengths, qsizetype count);
+
+private:
+    struct Job;
+    static void run(std::shared_ptr<Job> job);
+    static qsizetype findRegex(const Job& job, QVector<qsizetype>& positions, QVector<qsizetype>& lengths);
+    static void post(const std::shared_ptr<Job>& job, std::function<void(TextFinder*)> fn);
+
+    std::shared_ptr<Job> job;
+    static constexpr qsizetype maxPositions = 1 << 20;
+};
@@ -0,0 +1,124 @@
+#include "text_replacer.h"
+#include "text_search.h"
+#include <QRegularExpression>
+#include <limits>
+
+namespace {
+// Accumulates replaced matches into per-line edits
+class EditBuilder {
+public:
+    EditBuilder(QStringView text, TextReplacer::Result& result)
+        : text(text)
+        , result(result)
+    {
+    }
+
+    void add(qsizetype position, qsizetype length, QStringView replacement) {
+        // A match on the line the open edit ends on extends it: the text in
+        // between is carried over unchanged
+        if (open && !text.mid(end, position - end).contains(QLatin1Char('\n'))) {
+            current.text += text.mid(end, position - end);
+        } else {
+            flush();
+            open = true;
+            current.position = position;
+            current.text.clear();
+        }
+        current.text += replacement;
+        end = position + length;
+        ++result.count;
+    }
+
+    void flush() {
+        if (!open) return;
+        
+        current.length = end - current.position;
+        result.edits.append(current);
+        open = false;
+    }
+
+private:
+    QStringView text;
+    TextReplacer::Result& result;
+    TextReplacer::Edit current;
+    qsizetype end = 0;
+    bool open = false;
+};
+}
+
+TextReplacer::Result TextReplacer::replaceAll(const QString& text, const QString& pattern, const QString& replacement,
+                                              Qt::CaseSensitivity cs, bool regex) {
+    Result result;
+    if (pattern.isEmpty()) return result;
+    
+    EditBuilder builder(text, result);
+    if (!regex) {
+        QVector<qsizetype> positions;
+        TextSearch::findAll(text, pattern, cs, &positions, std::numeric_limits<qsizetype>::max());
+        for (qsizetype position : std::as_const(positions)) {
+            builder.add(position, pattern.size(), replacement);
+        }
+        builder.flush();
+        return result;
+    }
+    
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+    if (cs == Qt::CaseInsensitive) {
+        options |= QRegularExpression::CaseInsensitiveOption;
+    }
+    const QRegularExpression expression(pattern, options);
+    if (!expression.isValid()) {
+        result.error = expression.errorString();
+        return result;
+    }
+    
+    // The template is parsed once; each match only concatenates its parts
+    const QVector<Part> parts = parseReplacement(replacement);
+    QString expanded;
+    QRegularExpressionMatchIterator it = expression.globalMatch(text);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        expanded.clear();
+        for (const Part& part : parts) {
+            if (part.capture < 0) {
+                expanded += part.literal;
+            } else {
+                expanded += match.capturedView(part.capture);
+            }
+        }
+        builder.add(match.capturedStart(), match.capturedLength(), expanded);
+    }
+    builder.flush();
+    return result;
+}
+
+QVector<TextReplacer::Part> TextReplacer::parseReplacement(const QString& replacement) {
+    QVector<Part> parts;
+    QString literal;
+    for (qsizetype i = 0; i < replacement.size(); ++i) {
+        const QChar c = replacement[i];
+        if (c != QLatin1Char('\\') || i + 1 == replacement.size()) {
+            literal += c;
+            continue;
+        }
+        
+        const QChar next = replacement[++i];
+        if (next.isDigit()) {
+            if (!literal.isEmpty()) {
+                parts.append({literal, -1});
+                literal.clear();
+            }
+            parts.append({QString(), next.digitValue()});
+        } else if (next == QLatin1Char('n')) {
+            literal += QLatin1Char('\n');
+        } else if (next == QLatin1Char('t')) {
+            literal += QLatin1Char('\t');
+        } else {
+            literal += next;  // \\ and any other escaped character
+        }
+    }
+    if (!literal.isEmpty()) {
+        parts.append({literal, -1});
+    }
+    return parts;
+}
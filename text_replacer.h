@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+// Replace-all over a snapshot of the document, computed in one linear
+// pass. Matches on the same line are merged into a single edit, so the
+// result touches each affected block once when applied.
+class TextReplacer {
+public:
+    struct Edit {
+        qsizetype position;  // Offsets into the snapshot
+        qsizetype length;
+        QString text;
+    };
+
+    struct Result {
+        QVector<Edit> edits;  // Ascending, non-overlapping
+        qsizetype count = 0;  // Matches replaced
+        QString error;        // Set for an invalid pattern
+    };
+
+    // With regex, the replacement may refer to captures as \0 to \9 and
+    // use \n, \t and \; otherwise both strings are taken literally
+    static Result replaceAll(const QString& text, const QString& pattern, const QString& replacement,
+                             Qt::CaseSensitivity cs, bool regex);
+
+private:
+    struct Part {
+        QString literal;
+        int capture;  // -1 for a literal part
+    };
+
+    static QVector<Part> parseReplacement(const QString& replacement);
+};
@@ -0,0 +1,213 @@
+#include "text_search.h"
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TEXT_SEARCH_X86  // SSE2 is part of the x86-64 baseline; AVX2 is checked at runtime
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TEXT_SEARCH_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define TEXT_SEARCH_AVX2_TARGET
+#endif
+
+namespace {
+const qsizetype cancelCheckInterval = 1 << 20;  // Code units scanned between checks
+
+// One search in progress. Positions pass the filter when their first and
+// last code units, or'ed with a mask, equal the needle's; the mask folds
+// ASCII letters to lower case for case-insensitive search.
+struct Scan {
+    const char16_t* text;
+    qsizetype size;
+    const char16_t* needle;
+    qsizetype length;
+    Qt::CaseSensitivity cs;
+    QVector<qsizetype>* positions;
+    qsizetype maxPositions;
+    qsizetype count = 0;
+    qsizetype nextAllowed = 0;  // Matches don't overlap
+    char16_t firstMask;
+    char16_t firstValue;
+    char16_t lastMask;
+    char16_t lastValue;
+
+    static void filterFor(char16_t c, Qt::CaseSensitivity cs, char16_t& mask, char16_t& value) {
+        const bool letter = (c >= u'a' && c <= u'z') || (c >= u'A' && c <= u'Z');
+        if (cs == Qt::CaseSensitive || (c < 0x80 && !letter)) {
+            mask = 0;
+            value = c;
+        } else if (letter) {
+            mask = 0x20;
+            value = c | 0x20;
+        } else {
+            // Non-ASCII folding can't be done by masking; let everything through
+            mask = 0xFFFF;
+            value = 0xFFFF;
+        }
+    }
+
+    bool candidate(qsizetype pos) const {
+        return char16_t(text[pos] | firstMask) == firstValue
+            && char16_t(text[pos + length - 1] | lastMask) == lastValue;
+    }
+
+    void check(qsizetype pos) {
+        if (pos < nextAllowed) return;
+        
+        const bool equal = cs == Qt::CaseSensitive
+            ? std::memcmp(text + pos, needle, length * sizeof(char16_t)) == 0
+            : QStringView(text + pos, length).compare(QStringView(needle, length), Qt::CaseInsensitive) == 0;
+        if (!equal) return;
+        
+        if (positions && count < maxPositions) {
+            positions->append(pos);
+        }
+        ++count;
+        nextAllowed = pos + length;
+    }
+};
+
+// Each kernel checks the candidate starts in [from, to)
+void scanScalar(Scan& scan, qsizetype from, qsizetype to) {
+    for (qsizetype pos = from; pos < to; ++pos) {
+        if (scan.candidate(pos)) {
+            scan.check(pos);
+        }
+    }
+}
+
+#ifdef TEXT_SEARCH_X86
+void scanSse2(Scan& scan, qsizetype from, qsizetype to) {
+    const __m128i firstMask = _mm_set1_epi16(short(scan.firstMask));
+    const __m128i firstValue = _mm_set1_epi16(short(scan.firstValue));
+    const __m128i lastMask = _mm_set1_epi16(short(scan.lastMask));
+    const __m128i lastValue = _mm_set1_epi16(short(scan.lastValue));
+    
+    qsizetype pos = from;
+    for (; pos + 8 <= to; pos += 8) {
+        const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scan.text + pos));
+        const __m128i last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scan.text + pos + scan.length - 1));
+        const __m128i equal = _mm_and_si128(_mm_cmpeq_epi16(_mm_or_si128(first, firstMask), firstValue),
+                                            _mm_cmpeq_epi16(_mm_or_si128(last, lastMask), lastValue));
+        
+        // Two mask bits per 16-bit lane
+        uint bits = uint(_mm_movemask_epi8(equal));
+        while (bits) {
+            scan.check(pos + qCountTrailingZeroBits(bits) / 2);
+            bits &= bits - 1;
+            bits &= bits - 1;
+        }
+    }
+    scanScalar(scan, pos, to);
+}
+
+TEXT_SEARCH_AVX2_TARGET
+void scanAvx2(Scan& scan, qsizetype from, qsizetype to) {
+    const __m256i firstMask = _mm256_set1_epi16(short(scan.firstMask));
+    const __m256i firstValue = _mm256_set1_epi16(short(scan.firstValue));
+    const __m256i lastMask = _mm256_set1_epi16(short(scan.lastMask));
+    const __m256i lastValue = _mm256_set1_epi16(short(scan.lastValue));
+    
+    qsizetype pos = from;
+    for (; pos + 16 <= to; pos += 16) {
+        const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(scan.text + pos));
+        const __m256i last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(scan.text + pos + scan.length - 1));
+        const __m256i equal = _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_or_si256(first, firstMask), firstValue),
+                                               _mm256_cmpeq_epi16(_mm256_or_si256(last, lastMask), lastValue));
+        
+        uint bits = uint(_mm256_movemask_epi8(equal));
+        while (bits) {
+            scan.check(pos + qCountTrailingZeroBits(bits) / 2);
+            bits &= bits - 1;
+            bits &= bits - 1;
+        }
+    }
+    scanScalar(scan, pos, to);
+}
+
+bool cpuHasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = info[2] & (1 << 27);
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;  // OS must save the YMM registers
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+}
+
+TextSearch::Kernel TextSearch::bestKernel() {
+#ifdef TEXT_SEARCH_X86
+    static const Kernel best = cpuHasAvx2() ? AVX2 : SSE2;
+    return best;
+#else
+    return Scalar;
+#endif
+}
+
+const char* TextSearch::kernelName(Kernel kernel) {
+    switch (kernel) {
+        case SSE2:
+            return "sse2";
+        case AVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+qsizetype TextSearch::findAll(QStringView text, QStringView needle, Qt::CaseSensitivity cs,
+                              QVector<qsizetype>* positions, qsizetype maxPositions,
+                              const std::atomic<bool>* canceled) {
+    return findAll(bestKernel(), text, needle, cs, positions, maxPositions, canceled);
+}
+
+qsizetype TextSearch::findAll(Kernel kernel, QStringView text, QStringView needle, Qt::CaseSensitivity cs,
+                              QVector<qsizetype>* positions, qsizetype maxPositions,
+                              const std::atomic<bool>* canceled) {
+    if (needle.isEmpty() || needle.size() > text.size()) return 0;
+    kernel = qMin(kernel, bestKernel());
+    
+    Scan scan;
+    scan.text = text.utf16();
+    scan.size = text.size();
+    scan.needle = needle.utf16();
+    scan.length = needle.size();
+    scan.cs = cs;
+    scan.positions = positions;
+    scan.maxPositions = maxPositions;
+    Scan::filterFor(scan.needle[0], cs, scan.firstMask, scan.firstValue);
+    Scan::filterFor(scan.needle[scan.length - 1], cs, scan.lastMask, scan.lastValue);
+    
+    // Last position a match can start at, plus one
+    const qsizetype end = scan.size - scan.length + 1;
+    for (qsizetype from = 0; from < end; from += cancelCheckInterval) {
+        if (canceled && canceled->load(std::memory_order_relaxed)) return -1;
+        
+        const qsizetype to = qMin(end, from + cancelCheckInterval);
+        switch (kernel) {
+#ifdef TEXT_SEARCH_X86
+            case AVX2:
+                scanAvx2(scan, from, to);
+                break;
+            case SSE2:
+                scanSse2(scan, from, to);
+                break;
+#endif
+            default:
+                scanScalar(scan, from, to);
+                break;
+        }
+    }
+    return scan.count;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QStringView>
+#include <QVector>
+#include <atomic>
+
+// Substring search over UTF-16 text. Candidate positions are found by
+// comparing the needle's first and last code units against 16 (AVX2) or
+// 8 (SSE2) positions of the text at a time; only positions where both
+// agree are compared in full. Case-insensitive search folds ASCII letters
+// in the vector compare and leaves everything else to the full compare.
+class TextSearch {
+public:
+    enum Kernel {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    static Kernel bestKernel();  // Fastest one this CPU supports
+    static const char* kernelName(Kernel kernel);
+
+    // Counts non-overlapping matches and appends the offsets of the first
+    // maxPositions of them. Returns -1 if canceled along the way.
+    static qsizetype findAll(QStringView text, QStringView needle, Qt::CaseSensitivity cs,
+                             QVector<qsizetype>* positions, qsizetype maxPositions,
+                             const std::atomic<bool>* canceled = nullptr);
+    static qsizetype findAll(Kernel kernel, QStringView text, QStringView needle, Qt::CaseSensitivity cs,
+                             QVector<qsizetype>* positions, qsizetype maxPositions,
+                             const std::atomic<bool>* canceled = nullptr);
+};
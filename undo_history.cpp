@@ -0,0 +1,271 @@
+#include "undo_history.h"
+#include <QTextCursor>
+#include <QTextDocument>
+#include <utility>
+
+namespace {
+const int packThreshold = 16 * 1024;  // Removed text at least this long is compressed
+const int maxRunLength = 256;         // Typed characters merged into one step
+}
+
+UndoHistory::StoredText UndoHistory::StoredText::store(const QString& text) {
+    StoredText stored;
+    stored.length = text.size();
+    if (text.size() >= packThreshold) {
+        // Raw UTF-16, so any text round-trips exactly
+        stored.packed = qCompress(reinterpret_cast<const uchar*>(text.constData()), int(text.size() * sizeof(QChar)));
+    } else {
+        stored.plain = text;
+        stored.plain.squeeze();
+    }
+    return stored;
+}
+
+QString UndoHistory::StoredText::load() const {
+    if (packed.isEmpty()) return plain;
+    
+    const QByteArray raw = qUncompress(packed);
+    return QString(reinterpret_cast<const QChar*>(raw.constData()), raw.size() / qsizetype(sizeof(QChar)));
+}
+
+UndoHistory::UndoHistory(QTextDocument* document, QObject* parent)
+    : QObject(parent)
+    , document(document)
+    , capturedFrom(-1)
+    , usage(0)
+    , budget(64 * 1024 * 1024)
+    , nextStep(0)
+    , groupDepth(0)
+    , groupStep(0)
+    , enabled(true)
+    , applying(false)
+    , typingRun(false)
+{
+    connect(document, &QTextDocument::contentsChange,
+            this, &UndoHistory::handleContentsChange);
+}
+
+void UndoHistory::setEnabled(bool on) {
+    if (on == enabled) return;
+    
+    enabled = on;
+    clear();
+}
+
+void UndoHistory::setBudget(qint64 bytes) {
+    budget = bytes;
+    evict();
+}
+
+void UndoHistory::clear() {
+    undoStack.clear();
+    redoStack.clear();
+    captured = QString();
+    capturedFrom = -1;
+    typingRun = false;
+    setUsage(0);
+}
+
+void UndoHistory::capture(int from, int to) {
+    if (!enabled) return;
+    
+    const int length = document->characterCount() - 1;
+    from = qBound(0, from, length);
+    to = qBound(from, to, length);
+    captured = textAt(from, to - from);
+    capturedFrom = from;
+}
+
+void UndoHistory::beginGroup() {
+    if (groupDepth++ == 0) {
+        groupStep = nextStep++;
+        typingRun = false;
+    }
+}
+
+void UndoHistory::endGroup() {
+    if (groupDepth > 0) {
+        --groupDepth;
+    }
+}
+
+bool UndoHistory::undo(QTextCursor* cursor) {
+    return apply(undoStack, redoStack, cursor);
+}
+
+bool UndoHistory::redo(QTextCursor* cursor) {
+    return apply(redoStack, undoStack, cursor);
+}
+
+bool UndoHistory::apply(QList<Edit>& from, QList<Edit>& to, QTextCursor* cursor) {
+    if (!enabled || from.isEmpty()) return false;
+    
+    // Edits of a step are replayed one at a time rather than in one edit
+    // block, so the document is current when each inverse is read from it
+    const int step = from.last().step;
+    QTextCursor editCursor(document);
+    qint64 bytes = usage;
+    applying = true;
+    while (!from.isEmpty() && from.last().step == step) {
+        const Edit edit = from.takeLast();
+        const Edit inverse{edit.position, edit.text.length, StoredText::store(textAt(edit.position, edit.length)), step};
+    
+        editCursor.setPosition(edit.position);
+        editCursor.setPosition(edit.position + edit.length, QTextCursor::KeepAnchor);
+        editCursor.insertText(edit.text.load());
+    
+        to.append(inverse);
+        bytes += cost(inverse) - cost(edit);
+        if (cursor) {
+            cursor->setPosition(edit.position + edit.text.length);
+        }
+    }
+    applying = false;
+    typingRun = false;
+    setUsage(bytes);
+    return true;
+}
+
+void UndoHistory::handleContentsChange(int position, int charsRemoved, int charsAdded) {
+    if (!enabled || applying) {
+        capturedFrom = -1;
+        captured = QString();
+        return;
+    }
+    
+    // Qt may count the final paragraph separator on both sides; clamp to the text
+    const int newLength = document->characterCount() - 1;
+    const int oldLength = newLength - charsAdded + charsRemoved;
+    const int removed = qBound(0, qMin(charsRemoved, oldLength - position), charsRemoved);
+    const int added = qBound(0, qMin(charsAdded, newLength - position), charsAdded);
+    
+    // What the change removed, from the range captured before it
+    const bool covered = capturedFrom >= 0 && position >= capturedFrom
+        && position + removed <= capturedFrom + captured.size();
+    const QString removedText = covered ? captured.mid(position - capturedFrom, removed) : QString();
+    
+    // The highlighter reports reformatted blocks as same-length changes;
+    // the text edits among those were all captured first
+    if (removed == added && (!covered || removedText == textAt(position, added))) return;
+    
+    capturedFrom = -1;
+    captured = QString();
+    if (removed > 0 && !covered) {
+        // Nothing to restore it from, and older steps no longer line up
+        clear();
+        return;
+    }
+    
+    if (removed == 0 || added == 0) {
+        record(position, added, removedText);
+        return;
+    }
+    
+    // Replacements are often reported over a wider range than what
+    // changed (edit blocks report one span covering all their edits)
+    const QString addedText = textAt(position, added);
+    int prefix = 0;
+    while (prefix < removed && prefix < added && removedText[prefix] == addedText[prefix]) {
+        ++prefix;
+    }
+    int suffix = 0;
+    while (suffix < removed - prefix && suffix < added - prefix
+           && removedText[removed - 1 - suffix] == addedText[added - 1 - suffix]) {
+        ++suffix;
+    }
+    record(position + prefix, added - prefix - suffix, removedText.mid(prefix, removed - prefix - suffix));
+}
+
+void UndoHistory::record(int position, int charsAdded, const QString& removed) {
+    if (!tryMerge(position, charsAdded, removed)) {
+        const int step = groupDepth > 0 ? groupStep : nextStep++;
+        push({position, charsAdded, StoredText::store(removed), step});
+    }
+    
+    // Single typed characters and deletions start or extend a run; line
+    // breaks and anything larger end it
+    const bool typedCharacter = charsAdded == 1 && removed.size() <= 1
+        && document->characterAt(position) != QChar::ParagraphSeparator;
+    const bool deletedCharacter = charsAdded == 0 && removed.size() == 1;
+    typingRun = groupDepth == 0 && (typedCharacter || deletedCharacter);
+}
+
+bool UndoHistory::tryMerge(int position, int charsAdded, const QString& removed) {
+    if (!typingRun || groupDepth > 0 || undoStack.isEmpty()) return false;
+    
+    Edit& top = undoStack.last();
+    if (!top.text.packed.isEmpty() || top.length + top.text.length >= maxRunLength) return false;
+    
+    const qint64 before = cost(top);
+    if (charsAdded == 1 && removed.isEmpty()) {
+        if (position != top.position + top.length) return false;
+        if (document->characterAt(position) == QChar::ParagraphSeparator) return false;
+        top.length += 1;
+    } else if (charsAdded == 0 && removed.size() == 1) {
+        if (top.length > 0 && position == top.position + top.length - 1) {
+            top.length -= 1;  // Backspace over what the run typed
+        } else if (position + 1 == top.position) {
+            top.position = position;  // Backspace before it
+            top.text.plain.prepend(removed);
+            top.text.length += 1;
+        } else if (position == top.position + top.length) {
+            top.text.plain.append(removed);  // Delete after it
+            top.text.length += 1;
+        } else {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    
+    setUsage(usage + cost(top) - before);
+    return true;
+}
+
+void UndoHistory::push(Edit edit) {
+    // A new edit ends what could be redone
+    qint64 bytes = usage;
+    for (const Edit& dropped : std::as_const(redoStack)) {
+        bytes -= cost(dropped);
+    }
+    redoStack.clear();
+    
+    bytes += cost(edit);
+    undoStack.append(std::move(edit));
+    setUsage(bytes);
+    evict();
+}
+
+void UndoHistory::evict() {
+    // Oldest steps go first, whole steps at a time; the newest step is
+    // always kept so the last action can be undone
+    qint64 bytes = usage;
+    while (bytes > budget && !undoStack.isEmpty() && undoStack.first().step != undoStack.last().step) {
+        const int step = undoStack.first().step;
+        while (!undoStack.isEmpty() && undoStack.first().step == step) {
+            bytes -= cost(undoStack.first());
+            undoStack.removeFirst();
+        }
+    }
+    setUsage(bytes);
+}
+
+QString UndoHistory::textAt(int position, int length) const {
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(position + length, QTextCursor::KeepAnchor);
+    
+    // Block breaks come back as '\n', which QTextCursor::insertText turns
+    // into block breaks again
+    QString text = cursor.selectedText();
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    return text;
+}
+
+void UndoHistory::setUsage(qint64 bytes) {
+    if (bytes == usage) return;
+    
+    usage = bytes;
+    emit memoryUsageChanged(usage);
+}
+
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class QTextDocument;
+class QTextCursor;
+
+// Undo and redo for a QTextDocument within a memory budget, in place of
+// the document's own unbounded stack. Edits are recorded from
+// contentsChange; since Qt reports a change only once the removed text is
+// gone, every edit site captures the range it is about to replace first.
+// Inserted text isn't stored until it is undone, runs of typing merge into
+// one step, large removals are kept compressed, and the oldest steps are
+// dropped once over budget.
+class UndoHistory : public QObject {
+    Q_OBJECT
+
+public:
+    explicit UndoHistory(QTextDocument* document, QObject* parent = nullptr);
+
+    // While disabled (during loading) nothing is recorded or tracked;
+    // enabling starts over with an empty history
+    void setEnabled(bool enabled);
+    void setBudget(qint64 bytes);
+    void clear();
+
+    // Keeps the text of [from, to) for the next change to read what it
+    // removed from. A removal outside what was captured can't be undone,
+    // and ends the history.
+    void capture(int from, int to);
+
+    // Edits between these undo as one step
+    void beginGroup();
+    void endGroup();
+
+    // Leave the cursor where the step was undone or redone
+    bool undo(QTextCursor* cursor = nullptr);
+    bool redo(QTextCursor* cursor = nullptr);
+    bool canUndo() const { return !undoStack.isEmpty(); }
+    bool canRedo() const { return !redoStack.isEmpty(); }
+
+    // Bytes held by both stacks
+    qint64 memoryUsage() const { return usage; }
+
+signals:
+    void memoryUsageChanged(qint64 bytes);
+
+private slots:
+    void handleContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    // Text kept for an edit, compressed when large
+    struct StoredText {
+        QString plain;
+        QByteArray packed;
+        int length = 0;
+
+        static StoredText store(const QString& text);
+        QString load() const;
+        qint64 bytes() const { return plain.capacity() * qint64(sizeof(QChar)) + packed.capacity(); }
+    };
+
+    // Replacing the 'length' characters at 'position' with 'text' reverts
+    // the edit; doing so yields the edit that reapplies it
+    struct Edit {
+        int position;
+        int length;
+        StoredText text;
+        int step;
+    };
+
+    bool apply(QList<Edit>& from, QList<Edit>& to, QTextCursor* cursor);
+    void record(int position, int charsAdded, const QString& removed);
+    bool tryMerge(int position, int charsAdded, const QString& removed);
+    void push(Edit edit);
+    void evict();
+    QString textAt(int position, int length) const;
+    static qint64 cost(const Edit& edit) { return qint64(sizeof(Edit)) + edit.text.bytes(); }
+    void setUsage(qint64 bytes);
+
+    QTextDocument* document;
+    QString captured;   // Text of the range the next edit may replace
+    int capturedFrom;   // Its position, or -1 when nothing is captured
+    QList<Edit> undoStack;
+    QList<Edit> redoStack;
+    qint64 usage;
+    qint64 budget;
+    int nextStep;
+    int groupDepth;
+    int groupStep;
+    bool enabled;
+    bool applying;   // Set while undo or redo edits the document
+    bool typingRun;  // The top step may still take more typed characters
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QMetaObject>
+#include <QMutex>
+#include <memory>
+#include <utility>
+
+// Shared by the objects that run a Job on the thread pool: a Job with a
+// 'mutex' and a 'receiver' the owner clears when it stops listening, and
+// an owner holding its current Job in a std::shared_ptr member.
+//
+// Hands fn to the owner's thread, where it runs only if the job is still
+// the owner's current one. The job is identified through a weak_ptr
+// rather than its address, since a finished job's memory may be reused
+// by the next one before the result arrives; the weak_ptr keeps that
+// from happening.
+template <class Owner, class Job, class Fn>
+void postJobResult(const std::shared_ptr<Job>& job, std::shared_ptr<Job> Owner::*current, Fn fn) {
+    QMutexLocker locker(&job->mutex);
+    Owner* owner = job->receiver;
+    if (!owner) return;
+    
+    std::weak_ptr<Job> origin = job;
+    QMetaObject::invokeMethod(owner, [owner, current, origin = std::move(origin), fn = std::move(fn)] {
+        const std::shared_ptr<Job>& live = owner->*current;
+        if (live && !origin.owner_before(live) && !live.owner_before(origin)) {
+            fn(owner);
+        }
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,43 @@
+#include "zoom_preview.h"
+#include <QPainter>
+#include <QPaintEvent>
+
+ZoomPreview::ZoomPreview(QWidget* viewport)
+    : QWidget(viewport)
+    , scale(1.0)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    hide();
+}
+
+void ZoomPreview::begin() {
+    if (isActive()) return;
+    
+    // Taken at the committed font size; every step of the gesture scales this
+    snapshot = parentWidget()->grab();
+    scale = 1.0;
+    setGeometry(parentWidget()->rect());
+    show();
+    raise();
+}
+
+void ZoomPreview::setScale(qreal scale) {
+    this->scale = scale;
+    update();
+}
+
+void ZoomPreview::end() {
+    hide();
+    snapshot = QPixmap();
+}
+
+void ZoomPreview::paintEvent(QPaintEvent* event) {
+    QPainter painter(this);
+    painter.fillRect(event->rect(), palette().color(QPalette::Base));
+    
+    // Anchored top-left, where the text will reflow from once committed
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.scale(scale, scale);
+    painter.drawPixmap(0, 0, snapshot);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QPixmap>
+#include <QWidget>
+
+// Stands in for an editor viewport while a zoom gesture is in progress:
+// a snapshot of the viewport drawn at the pending zoom factor. The font
+// change, and the relayout it causes, is left until the gesture settles.
+class ZoomPreview : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit ZoomPreview(QWidget* viewport);
+    void begin();
+    void setScale(qreal scale);
+    void end();
+    bool isActive() const { return isVisible(); }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    QPixmap snapshot;
+    qreal scale;
+};